@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    AllocationGuard.cpp
+
+  ==============================================================================
+*/
+
+#include "AllocationGuard.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local int guardDepth = 0;
+    std::atomic<int> numViolations{ 0 };
+}
+
+AllocationGuard::ScopedNoAllocation::ScopedNoAllocation()   { ++guardDepth; }
+AllocationGuard::ScopedNoAllocation::~ScopedNoAllocation()  { --guardDepth; }
+
+bool AllocationGuard::isGuarded()           { return guardDepth > 0; }
+int AllocationGuard::getNumViolations()     { return numViolations.load(); }
+void AllocationGuard::resetViolations()     { numViolations.store(0); }
+
+#if BITDELAY_ALLOCATION_GUARD
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+//Only the tools define BITDELAY_ALLOCATION_GUARD, see AllocationGuard.h
+static void countIfGuarded()
+{
+    if (guardDepth > 0)
+    {
+        ++numViolations;
+        jassertfalse; //heap allocation on the audio thread
+    }
+}
+
+static void* guardedAllocate(std::size_t size)
+{
+    countIfGuarded();
+
+    if (auto* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+//Aligned blocks come from the aligned allocator, so they have to go back to its free
+static void* guardedAllocate(std::size_t size, std::align_val_t alignment)
+{
+    countIfGuarded();
+    size = size == 0 ? 1 : size;
+
+   #if JUCE_WINDOWS
+    if (auto* p = _aligned_malloc(size, (std::size_t)alignment))
+        return p;
+   #else
+    void* p = nullptr;
+
+    if (posix_memalign(&p, juce::jmax((std::size_t)alignment, sizeof(void*)), size) == 0)
+        return p;
+   #endif
+
+    throw std::bad_alloc();
+}
+
+static void freeAligned(void* p)
+{
+   #if JUCE_WINDOWS
+    _aligned_free(p);
+   #else
+    std::free(p);
+   #endif
+}
+
+void* operator new(std::size_t size)                                    { return guardedAllocate(size); }
+void* operator new[](std::size_t size)                                  { return guardedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept    { try { return guardedAllocate(size); } catch (...) { return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept  { try { return guardedAllocate(size); } catch (...) { return nullptr; } }
+void operator delete(void* p) noexcept                                  { std::free(p); }
+void operator delete[](void* p) noexcept                                { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept                     { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept                   { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept           { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept         { std::free(p); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)        { return guardedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment)      { return guardedAllocate(size, alignment); }
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return guardedAllocate(size, alignment); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return guardedAllocate(size, alignment); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p, std::align_val_t) noexcept                                { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                              { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept                   { freeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept                 { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept         { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept       { freeAligned(p); }
+
+#endif
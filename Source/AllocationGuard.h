@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    AllocationGuard.h
+
+    Debug helper that catches heap allocations made on the audio thread.
+    Build with BITDELAY_ALLOCATION_GUARD=1 and wrap realtime code in
+    BITDELAY_SCOPED_NO_ALLOCATION. Any operator new (plain, nothrow or
+    aligned) called inside that scope hits a jassert and is counted, so a
+    harness can fail when getNumViolations() is not zero.
+
+    The guard replaces the global allocation functions, which is only sound
+    for a whole program. The Debug builds of BitDelayBench and
+    BitDelayRender turn it on; the plugin never does, since it can't control
+    which operator new the host and the other plugins in the process bind to.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef BITDELAY_ALLOCATION_GUARD
+ #define BITDELAY_ALLOCATION_GUARD 0
+#endif
+
+namespace AllocationGuard
+{
+    //Marks the current thread as realtime for the lifetime of the object
+    struct ScopedNoAllocation
+    {
+        ScopedNoAllocation();
+        ~ScopedNoAllocation();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedNoAllocation)
+    };
+
+    //True while the calling thread is inside a ScopedNoAllocation
+    bool isGuarded();
+
+    //Number of allocations caught inside a guarded scope since the last reset
+    int getNumViolations();
+    void resetViolations();
+}
+
+#if BITDELAY_ALLOCATION_GUARD
+ #define BITDELAY_SCOPED_NO_ALLOCATION AllocationGuard::ScopedNoAllocation bitDelayNoAllocationScope
+#else
+ #define BITDELAY_SCOPED_NO_ALLOCATION
+#endif
@@ -0,0 +1,254 @@
+/*
+  ==============================================================================
+
+    BitDelayBank.cpp
+
+  ==============================================================================
+*/
+
+#include "BitDelayBank.h"
+#include "FeedbackKernel.h"
+#include "PluginProcessor.h"
+
+//Waits for a slice of voices, processes it and reports back. Only events are
+//used to hand work over, so process() doesn't allocate or take locks.
+class BitDelayBank::Worker : public juce::Thread
+{
+public:
+    Worker(BitDelayBank& bankToUse, int index)
+        : juce::Thread("BitDelayBank worker " + juce::String(index)), bank(bankToUse), scratchIndex(index)
+    {
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        startEvent.signal();
+        stopThread(-1);
+    }
+
+    void start(int first, int last, float* const* data, int samples)
+    {
+        firstVoice = first;
+        lastVoice = last;
+        voiceData = data;
+        numSamples = samples;
+        startEvent.signal();
+    }
+
+    void waitUntilDone()
+    {
+        doneEvent.wait(-1);
+    }
+
+    void run() override
+    {
+        for (;;)
+        {
+            startEvent.wait(-1);
+
+            if (threadShouldExit())
+                return;
+
+            bank.processVoices(firstVoice, lastVoice, voiceData, numSamples, scratchIndex);
+            doneEvent.signal();
+        }
+    }
+
+private:
+    BitDelayBank& bank;
+    const int scratchIndex;
+    juce::WaitableEvent startEvent, doneEvent;
+
+    int firstVoice{ 0 };
+    int lastVoice{ 0 };
+    float* const* voiceData{ nullptr };
+    int numSamples{ 0 };
+};
+
+//==============================================================================
+BitDelayBank::BitDelayBank()
+{
+}
+
+BitDelayBank::~BitDelayBank()
+{
+}
+
+void BitDelayBank::prepare(int numVoices, double sampleRate, int maxBlockSize, int numThreads)
+{
+    mWorkers.clear();
+
+    mNumVoices = juce::jmax(0, numVoices);
+    mSampleRate = sampleRate;
+    mMaxChunkSize = juce::jlimit(1, BitDelayAudioProcessor::maxChunkSize, maxBlockSize);
+
+    //Room for maxTime and a chunk
+    auto delayBufferSize = 2.0f * sampleRate;
+    mDelayLines.prepare(mNumVoices, (int)delayBufferSize, mMaxChunkSize);
+
+    const auto voices = (size_t)mNumVoices;
+    mWritePositions.assign(voices, 0);
+
+    const VoiceParameters defaults;
+    mBitDepths.assign(voices, defaults.bitDepth);
+    mInterpolations.assign(voices, defaults.interpolation);
+    mDecimations.assign(voices, defaults.decimation);
+    mDecimationFilter.prepare(mNumVoices, 1, (int)BitDelayAudioProcessor::derivateSampleRate(sampleRate, maxTime),
+                              mMaxChunkSize);
+    mAllpassStates.assign(voices, 0.0f);
+    mTimeSmoothers.assign(voices, {});
+    mRegenSmoothers.assign(voices, {});
+    mDrySmoothers.assign(voices, {});
+    mWetSmoothers.assign(voices, {});
+    mHoldStates.assign(voices, {});
+
+    for (size_t v = 0; v < voices; ++v)
+    {
+        mTimeSmoothers[v].reset(sampleRate, BitDelayAudioProcessor::timeSmoothingSeconds, defaults.time);
+        mRegenSmoothers[v].reset(sampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, defaults.regen);
+        mDrySmoothers[v].reset(sampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, defaults.dry);
+        mWetSmoothers[v].reset(sampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, defaults.wet);
+    }
+
+    numThreads = juce::jlimit(1, juce::jmax(1, mNumVoices), numThreads);
+    mScratch.assign((size_t)numThreads * numScratchBlocks * (size_t)mMaxChunkSize, 0.0f);
+    mReadIndexScratch.assign((size_t)numThreads * (size_t)mMaxChunkSize, 0);
+
+    //The calling thread does the first slice itself
+    for (int i = 1; i < numThreads; ++i)
+    {
+        mWorkers.push_back(std::make_unique<Worker>(*this, i));
+
+        //The audio thread waits on the workers every block. Where the system won't
+        //give out a real-time thread, the highest normal priority has to do.
+        if (! mWorkers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}))
+            mWorkers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void BitDelayBank::reset()
+{
+    mDelayLines.clear();
+    std::fill(mWritePositions.begin(), mWritePositions.end(), 0);
+    std::fill(mHoldStates.begin(), mHoldStates.end(), Decimator::ChannelState());
+    std::fill(mAllpassStates.begin(), mAllpassStates.end(), 0.0f);
+    mDecimationFilter.reset();
+
+    for (auto* smoothers : { &mTimeSmoothers, &mRegenSmoothers, &mDrySmoothers, &mWetSmoothers })
+        for (auto& smoother : *smoothers)
+            smoother.snapToTarget();
+}
+
+void BitDelayBank::setVoiceParameters(int voice, const VoiceParameters& parameters)
+{
+    jassert(juce::isPositiveAndBelow(voice, mNumVoices));
+    const auto v = (size_t)voice;
+
+    //Longer times would need a longer line and a larger rate divide than prepare() made room for
+    mTimeSmoothers[v].setTargetValue(juce::jlimit(0.0f, maxTime, parameters.time));
+    mRegenSmoothers[v].setTargetValue(parameters.regen);
+    mDrySmoothers[v].setTargetValue(parameters.dry);
+    mWetSmoothers[v].setTargetValue(parameters.wet);
+    mBitDepths[v] = parameters.bitDepth;
+
+    //A switched interpolation mode starts its allpass from rest, like the processor
+    if (mInterpolations[v] != parameters.interpolation)
+    {
+        mInterpolations[v] = parameters.interpolation;
+        mAllpassStates[v] = 0.0f;
+    }
+
+    //A switched decimation mode starts its filter from silence
+    if (mDecimations[v] != parameters.decimation)
+    {
+        mDecimations[v] = parameters.decimation;
+        mDecimationFilter.reset(voice);
+    }
+}
+
+void BitDelayBank::process(float* const* voiceData, int numSamples)
+{
+    const int numSlices = (int)mWorkers.size() + 1;
+
+    for (int slice = 1; slice < numSlices; ++slice)
+        mWorkers[(size_t)slice - 1]->start(mNumVoices * slice / numSlices, mNumVoices * (slice + 1) / numSlices,
+                                           voiceData, numSamples);
+
+    processVoices(0, mNumVoices / numSlices, voiceData, numSamples, 0);
+
+    for (auto& worker : mWorkers)
+        worker->waitUntilDone();
+}
+
+void BitDelayBank::processVoices(int firstVoice, int lastVoice, float* const* voiceData, int numSamples, int scratchIndex)
+{
+    auto* scratch = mScratch.data() + (size_t)scratchIndex * numScratchBlocks * (size_t)mMaxChunkSize;
+    auto* readIndices = mReadIndexScratch.data() + (size_t)scratchIndex * (size_t)mMaxChunkSize;
+
+    for (int voice = firstVoice; voice < lastVoice; ++voice)
+    {
+        //Chunked exactly like BitDelayAudioProcessor::processBlock, so the smoothing and the rate divide line up
+        for (int startSample = 0; startSample < numSamples; startSample += mMaxChunkSize)
+            processVoice(voice, voiceData[voice] + startSample, juce::jmin(mMaxChunkSize, numSamples - startSample),
+                         scratch, readIndices);
+    }
+}
+
+//The per-channel path of BitDelayAudioProcessor::processSpan (the fused kernel) for a single voice
+void BitDelayBank::processVoice(int voice, float* data, int numSamples, float* scratch, int* readIndices)
+{
+    const auto v = (size_t)voice;
+    const int writePosition = mWritePositions[v];
+
+    auto* times = scratch;
+    auto* feedback = scratch + mMaxChunkSize;
+    auto* dryGains = scratch + 2 * mMaxChunkSize;
+    auto* wetGains = scratch + 3 * mMaxChunkSize;
+    auto* readFractions = scratch + 4 * mMaxChunkSize;
+    auto* decimated = scratch + 5 * mMaxChunkSize;
+
+    const auto rateDivide = (int)BitDelayAudioProcessor::derivateSampleRate(mSampleRate, mTimeSmoothers[v].getCurrentValue());
+
+    const bool timeIsSmoothing = mTimeSmoothers[v].isSmoothing();
+    mTimeSmoothers[v].process(times, numSamples);
+    mRegenSmoothers[v].process(feedback, numSamples);
+    mDrySmoothers[v].process(dryGains, numSamples);
+    mWetSmoothers[v].process(wetGains, numSamples);
+
+    const auto interpolation = mInterpolations[v];
+    DelayInterpolation::TapPositions tapPositions;
+
+    if (timeIsSmoothing)
+    {
+        DelayInterpolation::fillTapPositions(interpolation, writePosition, times, mSampleRate, mDelayLines.getMask(),
+                                             readIndices, readFractions, numSamples);
+        tapPositions.indices = readIndices;
+        tapPositions.fractions = readFractions;
+    }
+    else
+    {
+        DelayInterpolation::getTapPosition(interpolation, writePosition, mSampleRate * mTimeSmoothers[v].getTargetValue(),
+                                           mDelayLines.getMask(), tapPositions.startIndex, tapPositions.fraction);
+    }
+
+    FeedbackKernel::Parameters parameters{ feedback, dryGains, wetGains, interpolation, tapPositions, mBitDepths[v], rateDivide };
+
+    //Same split as the processor: only a plain sample-and-hold is left to the kernel's loop
+    if (mDecimations[v] != DecimationFilter::Mode::hold || rateDivide <= 1)
+    {
+        std::copy(data, data + numSamples, decimated);
+
+        if (mDecimations[v] == DecimationFilter::Mode::hold)
+            Decimator::process(mHoldStates[v], decimated, numSamples, mBitDepths[v], rateDivide);
+        else
+            mDecimationFilter.process<1>(mDecimations[v], voice, decimated, numSamples, &mHoldStates[v].heldValue,
+                                         mHoldStates[v].holdCounter, mBitDepths[v], rateDivide);
+
+        parameters.decimated = decimated;
+    }
+
+    FeedbackKernel::process(mDelayLines, voice, writePosition, data, numSamples, parameters, mHoldStates[v], mAllpassStates[v]);
+
+    mWritePositions[v] = mDelayLines.wrap(writePosition + numSamples);
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    BitDelayBank.h
+
+    Runs many independent mono BitDelay voices in one call, for servers that
+    would otherwise keep one BitDelayAudioProcessor per emitter. Voice state
+    is kept as structure-of-arrays: all delay lines live in one allocation,
+    and parameters, write positions, gain ramps and hold state are plain
+    arrays indexed by voice.
+
+    A voice is the processor's fused mono engine and nothing more: no Max
+    Time (the Time range stays 0..maxTime), no extra taps, no pooled or
+    compact storage and no sleep, so a voice keeps processing silence. Host
+    blocks are cut into chunks of at most BitDelayAudioProcessor::maxChunkSize
+    like the processor's. Within that, a voice sounds exactly like a mono
+    BitDelayAudioProcessor at the default Max Time with the taps off, fed
+    input that never goes quiet long enough for it to sleep; BitDelayBench
+    checks that before it times anything.
+
+    With more than one thread the voice range is split into contiguous
+    slices, one per worker. The calling thread takes the first slice, so
+    numThreads == 1 never touches another thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DecimationFilter.h"
+#include "Decimator.h"
+#include "DelayInterpolation.h"
+#include "DelayLine.h"
+#include "PluginProcessor.h"
+#include "ParameterSmoother.h"
+#include <vector>
+
+class BitDelayBank
+{
+public:
+    //Longest time a voice takes, the processor's Time range at the default Max Time
+    static constexpr float maxTime = BitDelayAudioProcessor::timeRangeEnd;
+
+    //Defaults match a freshly created BitDelayAudioProcessor
+    struct VoiceParameters
+    {
+        float time{ maxTime };
+        float regen{ 0.7f };
+        float dry{ 0.7f };
+        float wet{ 0.7f };
+        int bitDepth{ 8 };
+        DelayInterpolation::Mode interpolation{ DelayInterpolation::Mode::linear };
+        DecimationFilter::Mode decimation{ DecimationFilter::Mode::hold };
+    };
+
+    BitDelayBank();
+    ~BitDelayBank();
+
+    //Allocates everything and starts the workers, don't call from the audio thread
+    void prepare(int numVoices, double sampleRate, int maxBlockSize, int numThreads = 1);
+
+    //Clears the delay lines and jumps every voice straight to its parameters,
+    //like a processor that is prepared after its parameters were set
+    void reset();
+
+    int getNumVoices() const { return mNumVoices; }
+
+    //time is clamped to 0..maxTime
+    void setVoiceParameters(int voice, const VoiceParameters& parameters);
+
+    //voiceData[v] holds numSamples of voice v's audio and is processed in place
+    void process(float* const* voiceData, int numSamples);
+
+private:
+    class Worker;
+
+    void processVoices(int firstVoice, int lastVoice, float* const* voiceData, int numSamples, int scratchIndex);
+    void processVoice(int voice, float* data, int numSamples, float* scratch, int* readIndices);
+
+    int mNumVoices{ 0 };
+    int mMaxChunkSize{ 0 };
+    double mSampleRate{ 44100.0 };
+
+    //One delay line channel per voice, all in one allocation
+    DelayLine mDelayLines;
+    std::vector<int> mWritePositions;
+
+    std::vector<int> mBitDepths;
+    std::vector<DelayInterpolation::Mode> mInterpolations;
+    std::vector<DecimationFilter::Mode> mDecimations;
+    DecimationFilter mDecimationFilter;     //one channel per voice
+    std::vector<float> mAllpassStates;
+    std::vector<ParameterSmoother> mTimeSmoothers;
+    std::vector<ParameterSmoother> mRegenSmoothers;
+    std::vector<ParameterSmoother> mDrySmoothers;
+    std::vector<ParameterSmoother> mWetSmoothers;
+    std::vector<Decimator::ChannelState> mHoldStates;
+
+    //Per thread: time, feedback, dry and wet gain, tap fraction and decimated input blocks, plus tap indices
+    static constexpr int numScratchBlocks = 6;
+    std::vector<float> mScratch;
+    std::vector<int> mReadIndexScratch;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BitDelayBank)
+};
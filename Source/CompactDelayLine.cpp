@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    CompactDelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "CompactDelayLine.h"
+
+namespace
+{
+    constexpr float storeScale = 32768.0f / CompactDelayLine::fullScale;
+    constexpr float expandScale = 1.0f / storeScale;
+}
+
+int CompactDelayLine::getStorageDivide(double sampleRate)
+{
+    int divide = 1;
+
+    while (divide * 2 <= (int)(sampleRate / 22050.0))
+        divide *= 2;
+
+    return divide;
+}
+
+void CompactDelayLine::prepare(int numChannels, int minimumLength, double sampleRate)
+{
+    mNumChannels = juce::jmax(0, numChannels);
+    mShift = 0;
+
+    for (int divide = getStorageDivide(sampleRate); divide > 1; divide /= 2)
+        ++mShift;
+
+    //At least one stored sample, and a whole number of them
+    mLength = juce::nextPowerOfTwo(juce::jmax(getStorageDivide(), minimumLength));
+    mChannelStride = (size_t)(mLength >> mShift);
+
+    mData.assign((size_t)mNumChannels * mChannelStride, 0);
+}
+
+void CompactDelayLine::clear()
+{
+    std::fill(mData.begin(), mData.end(), (juce::int16)0);
+}
+
+void CompactDelayLine::write(int channel, int position, const float* source, int numSamples)
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+
+    auto* data = mData.data() + (size_t)channel * mChannelStride;
+    const int divide = getStorageDivide();
+
+    //First host sample of each hold period inside the block
+    int offset = (divide - (position & (divide - 1))) & (divide - 1);
+
+    for (; offset < numSamples; offset += divide)
+    {
+        const float scaled = juce::jlimit(-32768.0f, 32767.0f, source[offset] * storeScale);
+        data[wrap(position + offset) >> mShift] = (juce::int16)juce::roundToInt(scaled);
+    }
+}
+
+void CompactDelayLine::read(int channel, int position, float* dest, int numSamples) const
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+
+    const auto* data = mData.data() + (size_t)channel * mChannelStride;
+
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] = (float)data[wrap(position + i) >> mShift] * expandScale;
+}
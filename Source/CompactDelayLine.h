@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    CompactDelayLine.h
+
+    Delay storage for the processor's compact mode. Samples are kept as
+    16-bit integers and only every storageDivide-th host sample is stored,
+    the ones in between are held, the same way Decimator holds its output.
+    storageDivide is the largest power of two at or below
+    sampleRate / 22050, i.e. never slower than the fastest rate the
+    decimator runs at, so the echoes keep their character while the line
+    takes a quarter (44.1/48 kHz) to a sixteenth (176.4/192 kHz) of the
+    memory of a float DelayLine.
+
+    Values are stored with two bits of headroom (full scale is +-4) and a
+    resolution of 2^-13, finer than the crusher's grid for bit depths up to
+    13. Reads expand a window back to floats.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class CompactDelayLine
+{
+public:
+    static constexpr float fullScale = 4.0f;
+
+    //The divider used for a sample rate, a power of two
+    static int getStorageDivide(double sampleRate);
+
+    //Holds at least minimumLength host samples per channel
+    void prepare(int numChannels, int minimumLength, double sampleRate);
+    void clear();
+
+    int getLength() const           { return mLength; }
+    int getStorageDivide() const    { return 1 << mShift; }
+    int wrap(int position) const    { return position & (mLength - 1); }
+    size_t getNumBytes() const      { return mData.size() * sizeof(juce::int16); }
+
+    //Stores the held samples of numSamples host samples written at position
+    void write(int channel, int position, const float* source, int numSamples);
+
+    //Expands numSamples host samples starting at position (any integer, wrapped) into dest
+    void read(int channel, int position, float* dest, int numSamples) const;
+
+private:
+    int mNumChannels{ 0 };
+    int mLength{ 1 };           //host samples, power of two
+    int mShift{ 0 };            //log2 of the storage divider
+    size_t mChannelStride{ 0 };
+    std::vector<juce::int16> mData;     //[channel][stored sample]
+};
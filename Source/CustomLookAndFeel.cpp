@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    CustomLookAndFeel.cpp
+
+  ==============================================================================
+*/
+
+#include "CustomLookAndFeel.h"
+
+namespace
+{
+    float getTrackWidth(int width, int height, bool horizontal)
+    {
+        return juce::jmin(6.0f, horizontal ? (float)height * 0.25f : (float)width * 0.25f);
+    }
+}
+
+const juce::Image& CustomLookAndFeel::getCachedImage(Art art, int width, int height, float scale,
+                                                    const std::function<void(juce::Graphics&)>& paint)
+{
+    for (auto& cached : mCache)
+        if (cached.art == art && cached.width == width && cached.height == height && cached.scale == scale)
+            return cached.image;
+
+    if ((int)mCache.size() >= maxCachedImages)
+        mCache.erase(mCache.begin());
+
+    juce::Image image(juce::Image::ARGB, juce::jmax(1, juce::roundToInt((float)width * scale)),
+                      juce::jmax(1, juce::roundToInt((float)height * scale)), true);
+    {
+        juce::Graphics imageGraphics(image);
+        imageGraphics.addTransform(juce::AffineTransform::scale(scale));
+        paint(imageGraphics);
+    }
+
+    mCache.push_back({ art, width, height, scale, image });
+    return mCache.back().image;
+}
+
+void CustomLookAndFeel::drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
+                                         const float rotaryStartAngle, const float rotaryEndAngle, juce::Slider&)
+{
+    auto radius = (float)juce::jmin(width / 2, height / 2) - 4.0f;
+    auto centreX = (float)x + (float)width * 0.5f;
+    auto centreY = (float)y + (float)height * 0.5f;
+    auto angle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    // outline
+    const auto& ring = getCachedImage(Art::knobRing, width, height, scale, [=](juce::Graphics& ig)
+    {
+        auto rw = radius * 2.0f;
+        ig.setColour(juce::Colours::darkred);
+        ig.drawEllipse((float)width * 0.5f - radius, (float)height * 0.5f - radius, rw, rw, 2.0f);
+    });
+
+    g.drawImage(ring, juce::Rectangle<float>((float)x, (float)y, (float)width, (float)height));
+
+    // pointer, built once per knob size and rotated into place
+    if (radius != mPointerRadius)
+    {
+        auto pointerLength = radius * 0.33f;
+        auto pointerThickness = 2.0f;
+        mPointer.clear();
+        mPointer.addRectangle(-pointerThickness * 0.5f, -radius, pointerThickness, pointerLength);
+        mPointerRadius = radius;
+    }
+
+    g.setColour(juce::Colours::darkred);
+    g.fillPath(mPointer, juce::AffineTransform::rotation(angle).translated(centreX, centreY));
+}
+
+void CustomLookAndFeel::drawLinearSlider(juce::Graphics& g, int x, int y, int width, int height,
+                                         float sliderPos,
+                                         float minSliderPos,
+                                         float maxSliderPos,
+                                         const juce::Slider::SliderStyle style, juce::Slider& slider)
+{
+    const bool horizontal = slider.isHorizontal();
+    auto trackWidth = getTrackWidth(width, height, horizontal);
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    //Local coordinates of the slider box, the cached track is drawn in them
+    juce::Point<float> startPoint(horizontal ? 0.0f : (float)width * 0.5f,
+                                  horizontal ? (float)height * 0.5f : (float)height);
+
+    juce::Point<float> endPoint(horizontal ? (float)width : startPoint.x,
+                                horizontal ? startPoint.y : 0.0f);
+
+    const auto& track = getCachedImage(horizontal ? Art::horizontalTrack : Art::verticalTrack, width, height, scale, [=](juce::Graphics& ig)
+    {
+        juce::Path backgroundTrack;
+        backgroundTrack.startNewSubPath(startPoint);
+        backgroundTrack.lineTo(endPoint);
+        ig.setColour(juce::Colours::black);
+        ig.strokePath(backgroundTrack, { trackWidth, juce::PathStrokeType::mitered, juce::PathStrokeType::square });
+    });
+
+    g.drawImage(track, juce::Rectangle<float>((float)x, (float)y, (float)width, (float)height));
+
+    auto kx = horizontal ? sliderPos : ((float)x + (float)width * 0.5f);
+    auto ky = horizontal ? ((float)y + (float)height * 0.5f) : sliderPos;
+
+    juce::Point<float> minPoint = startPoint + juce::Point<float>((float)x, (float)y);
+    juce::Point<float> maxPoint{ kx, ky };
+
+    //A square-capped stroke is the rectangle between the points, widened by half the track
+    g.setColour(juce::Colours::darkred);
+    g.fillRect(juce::Rectangle<float>(minPoint, maxPoint).expanded(trackWidth * 0.5f));
+
+    auto thumbWidth = getSliderThumbRadius(slider);
+
+    const auto& thumb = getCachedImage(Art::sliderThumb, thumbWidth, thumbWidth, scale, [=](juce::Graphics& ig)
+    {
+        ig.setColour(juce::Colours::white);
+        ig.fillEllipse(0.0f, 0.0f, (float)thumbWidth, (float)thumbWidth);
+    });
+
+    g.drawImage(thumb, juce::Rectangle<float>((float)thumbWidth, (float)thumbWidth).withCentre(maxPoint));
+
+    //if (slider.isBar())
+        //drawLinearSliderOutline(g, x, y, width, height, style, slider);
+}
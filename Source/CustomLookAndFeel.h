@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    CustomLookAndFeel.h
+
+    The editor's knobs and sliders. Everything that only depends on a
+    control's size (the knob ring, the slider track, the thumb) is rendered
+    once into an image at the display's pixel scale and reused until the
+    size or scale changes, so a repaint is a couple of image blits plus the
+    value-dependent part: the knob pointer (one cached Path, transformed)
+    and the value track (a filled rectangle).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <vector>
+
+class CustomLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    void drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
+                          const float rotaryStartAngle, const float rotaryEndAngle, juce::Slider&) override;
+
+    void drawLinearSlider(juce::Graphics& g, int x, int y, int width, int height,
+                          float sliderPos, float minSliderPos, float maxSliderPos,
+                          const juce::Slider::SliderStyle style, juce::Slider& slider) override;
+
+    //Sizes of cached art kept at once, older ones are rendered again when needed
+    static constexpr int maxCachedImages = 16;
+
+private:
+    enum class Art { knobRing, horizontalTrack, verticalTrack, sliderThumb };
+
+    struct CachedImage
+    {
+        Art art;
+        int width;
+        int height;
+        float scale;
+        juce::Image image;
+    };
+
+    //The image for art of this size at this pixel scale, drawing it with paint
+    //(in component coordinates) when it isn't cached yet
+    const juce::Image& getCachedImage(Art art, int width, int height, float scale,
+                                      const std::function<void(juce::Graphics&)>& paint);
+
+    std::vector<CachedImage> mCache;
+
+    juce::Path mPointer;
+    float mPointerRadius{ -1.0f };
+};
@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    DecimationFilter.cpp
+
+  ==============================================================================
+*/
+
+#include "DecimationFilter.h"
+#include "Decimator.h"
+#include "InterleavedDelay.h"
+
+namespace
+{
+    //Zeroth order modified Bessel function, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+        {
+            term *= (x * x) / (4.0 * k * k);
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    double getKaiserBeta(double stopbandDb)
+    {
+        if (stopbandDb > 50.0)
+            return 0.1102 * (stopbandDb - 8.7);
+
+        return 0.5842 * std::pow(stopbandDb - 21.0, 0.4) + 0.07886 * (stopbandDb - 21.0);
+    }
+
+    double getStopbandDb(DecimationFilter::Mode mode)
+    {
+        return mode == DecimationFilter::Mode::cleanHigh ? 80.0 : 50.0;
+    }
+
+    //One filter output per lane, from eight partial sums so a single lane vectorises too.
+    //Every lane adds up in the same order, so packed lanes match single channels exactly.
+    //numTaps is always a multiple of 8.
+    template <int Lanes>
+    forcedinline void filterFrame(const float* taps, const float* window, int numTaps, float* sums)
+    {
+        float partials[8 * Lanes] = {};
+
+        for (int k = 0; k < numTaps; k += 8)
+            for (int j = 0; j < 8; ++j)
+                for (int lane = 0; lane < Lanes; ++lane)
+                    partials[j * Lanes + lane] += taps[k + j] * window[(k + j) * Lanes + lane];
+
+        for (int lane = 0; lane < Lanes; ++lane)
+        {
+            const float* p = partials + lane;
+            sums[lane] = ((p[0] + p[4 * Lanes]) + (p[Lanes] + p[5 * Lanes]))
+                       + ((p[2 * Lanes] + p[6 * Lanes]) + (p[3 * Lanes] + p[7 * Lanes]));
+        }
+    }
+}
+
+int DecimationFilter::getTapsPerPhase(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::clean:       return 8;
+        case Mode::cleanHigh:   return 32;
+        default:                return 0;
+    }
+}
+
+std::vector<float> DecimationFilter::design(int rateDivide, int tapsPerPhase, double stopbandDb)
+{
+    //Cutoff at the reduced rate's Nyquist frequency, the transition band folds onto itself
+    const int numTaps = tapsPerPhase * rateDivide;
+    const double cutoff = 0.5 / rateDivide;
+    const double beta = getKaiserBeta(stopbandDb);
+    const double centre = 0.5 * (numTaps - 1);
+
+    std::vector<double> taps((size_t)numTaps);
+    double sum = 0.0;
+
+    for (int k = 0; k < numTaps; ++k)
+    {
+        const double t = k - centre;
+        const double sinc = t == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::twoPi * cutoff * t)
+                                                 / (juce::MathConstants<double>::twoPi * cutoff * t);
+        const double ratio = t / (centre + 0.5);
+        const double window = besselI0(beta * std::sqrt(juce::jmax(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+
+        taps[(size_t)k] = sinc * window;
+        sum += taps[(size_t)k];
+    }
+
+    //Unity gain at DC, so a held constant stays exactly on its quantization step
+    std::vector<float> filter((size_t)numTaps);
+    for (int k = 0; k < numTaps; ++k)
+        filter[(size_t)k] = (float)(taps[(size_t)k] / sum);
+
+    return filter;
+}
+
+void DecimationFilter::prepare(int numChannels, int lanes, int maxRateDivide, int maxBlockSize)
+{
+    mNumChannels = juce::jmax(0, numChannels);
+    mLanes = juce::jmax(1, lanes);
+    mMaxRateDivide = juce::jmax(1, maxRateDivide);
+
+    for (int m = 0; m < numModes; ++m)
+    {
+        const auto mode = (Mode)m;
+        auto& filters = mFilters[m];
+        filters.clear();
+
+        if (mode == Mode::hold)
+            continue;
+
+        //Rate divide 1 means no rate reduction and never filters
+        filters.resize((size_t)mMaxRateDivide + 1);
+        for (int rateDivide = 2; rateDivide <= mMaxRateDivide; ++rateDivide)
+            filters[(size_t)rateDivide] = design(rateDivide, getTapsPerPhase(mode), getStopbandDb(mode));
+    }
+
+    mHistoryLength = getTapsPerPhase(Mode::cleanHigh) * mMaxRateDivide - 1;
+    mChannelStride = (size_t)(mHistoryLength + juce::jmax(1, maxBlockSize)) * (size_t)mLanes;
+    mHistory.assign(mChannelStride * (size_t)mNumChannels, 0.0f);
+}
+
+void DecimationFilter::reset()
+{
+    std::fill(mHistory.begin(), mHistory.end(), 0.0f);
+}
+
+void DecimationFilter::reset(int channel)
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    auto* history = mHistory.data() + (size_t)channel * mChannelStride;
+    std::fill(history, history + mChannelStride, 0.0f);
+}
+
+const std::vector<float>& DecimationFilter::getFilter(Mode mode, int rateDivide) const
+{
+    return mFilters[(int)mode][(size_t)juce::jmin(rateDivide, mMaxRateDivide)];
+}
+
+template <int Lanes>
+void DecimationFilter::process(Mode mode, int channel, float* frames, int numFrames, float* heldValues, int& holdCounter,
+                               int bitDepth, int rateDivide)
+{
+    jassert(mode != Mode::hold);
+    jassert(Lanes == mLanes);
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    jassert((size_t)(mHistoryLength + numFrames) * Lanes <= mChannelStride);
+    jassert(rateDivide <= mMaxRateDivide); //prepare() was given a rate divide that is too small
+
+    const float qLevels = (float)(1 << juce::jlimit(Decimator::minBitDepth, Decimator::maxBitDepth, bitDepth));
+    const float invQLevels = 1.0f / qLevels;
+
+    rateDivide = juce::jmax(1, rateDivide);
+
+    //The history and this block side by side, so every filter window is contiguous
+    float* history = mHistory.data() + (size_t)channel * mChannelStride;
+    float* input = history + (size_t)mHistoryLength * Lanes;
+    std::copy(frames, frames + numFrames * Lanes, input);
+
+    //Without rate reduction this is the plain quantizer. The history still follows
+    //the input, so a later rate reduction filters with real neighbours.
+    if (rateDivide == 1)
+    {
+        holdCounter = 0;
+        Decimator::quantize(frames, numFrames * Lanes, qLevels, invQLevels);
+    }
+    else
+    {
+        const auto& filter = getFilter(mode, rateDivide);
+        const float* taps = filter.data();
+        const int numTaps = (int)filter.size();
+
+        if (holdCounter >= rateDivide)
+            holdCounter = 0;
+
+        int i = 0;
+        while (i < numFrames)
+        {
+            if (holdCounter == 0)
+            {
+                //The filter is symmetric, so it runs forwards over the window ending at frame i
+                float sums[Lanes];
+                filterFrame<Lanes>(taps, input + (i - numTaps + 1) * Lanes, numTaps, sums);
+
+                for (int lane = 0; lane < Lanes; ++lane)
+                    heldValues[lane] = Decimator::quantizeSample(sums[lane], qLevels, invQLevels);
+            }
+
+            const int runLength = juce::jmin(rateDivide - holdCounter, numFrames - i);
+            for (int j = i; j < i + runLength; ++j)
+                std::copy(heldValues, heldValues + Lanes, frames + j * Lanes);
+
+            holdCounter = (holdCounter + runLength) % rateDivide;
+            i += runLength;
+        }
+    }
+
+    //Keep the newest frames for the next block's windows
+    std::copy(input + (numFrames - mHistoryLength) * Lanes, input + numFrames * Lanes, history);
+}
+
+template void DecimationFilter::process<1>(Mode, int, float*, int, float*, int&, int, int);
+template void DecimationFilter::process<InterleavedDelay::numLanes>(Mode, int, float*, int, float*, int&, int, int);
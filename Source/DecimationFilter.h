@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    DecimationFilter.h
+
+    Band-limited alternative to the plain sample-and-hold. In the clean
+    modes every held value is the input low-passed at the reduced rate's
+    Nyquist frequency, so the hold no longer folds everything above it
+    back down.
+
+    The filters are Kaiser windowed sincs, one per rate divide R, with
+    getTapsPerPhase() * R taps. Only the samples the hold keeps are
+    filtered, one dot product every R input samples, so the cost per input
+    sample is the taps per phase whatever the rate divide:
+
+        Mode        taps/phase  multiply-adds per   -1 dB up to     stopband from
+                                input sample
+        hold        -           0                   -               -
+        clean       8           8                   0.40 x rate     0.69 x rate, ~50 dB
+        cleanHigh   32          32                  0.46 x rate     0.58 x rate, ~80 dB
+
+    with frequencies relative to the reduced rate (host rate / R).
+
+    The filters are linear phase, so the decimated signal (and with it the
+    echoes) comes (taps - 1) / 2 input samples later: 8R / 2 in clean, 32R / 2
+    in cleanHigh, at most about 5 ms at the longest delay times.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class DecimationFilter
+{
+public:
+    enum class Mode
+    {
+        hold,       //plain sample-and-hold, like the original plugin
+        clean,
+        cleanHigh
+    };
+
+    static constexpr int numModes = 3;
+
+    static int getTapsPerPhase(Mode mode);
+
+    //Designs the filters for every rate divide up to maxRateDivide and keeps input
+    //history for numChannels channels of lanes floats per frame. Not for the audio thread.
+    void prepare(int numChannels, int lanes, int maxRateDivide, int maxBlockSize);
+
+    //Forgets the input history, for when a clean mode is switched on
+    void reset();
+    void reset(int channel);
+
+    //Sample-and-hold of numFrames frames in place, like Decimator, but every held
+    //value is band-limited first and then quantized to bitDepth. heldValues (Lanes
+    //floats) and holdCounter are the hold state, shared with the plain hold so the
+    //phase carries over when the mode changes. Lanes has to match prepare().
+    template <int Lanes>
+    void process(Mode mode, int channel, float* frames, int numFrames, float* heldValues, int& holdCounter,
+                 int bitDepth, int rateDivide);
+
+private:
+    static std::vector<float> design(int rateDivide, int tapsPerPhase, double stopbandDb);
+    const std::vector<float>& getFilter(Mode mode, int rateDivide) const;
+
+    int mNumChannels{ 0 };
+    int mLanes{ 1 };
+    int mMaxRateDivide{ 1 };
+    int mHistoryLength{ 0 };            //frames kept from earlier blocks
+    size_t mChannelStride{ 0 };
+
+    std::vector<std::vector<float>> mFilters[numModes];    //[mode][rateDivide]
+    std::vector<float> mHistory;        //[channel][history + block][lane]
+};
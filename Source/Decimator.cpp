@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    Decimator.cpp
+
+  ==============================================================================
+*/
+
+#include "Decimator.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    //Inlined into every kernel so the quantization constants fold away
+    forcedinline void quantizeSpan(float* data, int numSamples, float qLevels, float invQLevels)
+    {
+        int i = 0;
+
+        //Values at or above 2^23 / qLevels are already on the grid and would overflow
+        //the int conversion, so those lanes (and NaNs) pass through unchanged.
+        //Adding +0 turns -0 results into +0, matching what the fmodf form produces.
+        const float integralLimit = 8388608.0f * invQLevels;
+
+#if defined(__AVX__)
+        {
+            const auto levels = _mm256_set1_ps(qLevels);
+            const auto invLevels = _mm256_set1_ps(invQLevels);
+            const auto limit = _mm256_set1_ps(integralLimit);
+            const auto signMask = _mm256_set1_ps(-0.0f);
+            const auto zero = _mm256_setzero_ps();
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                auto value = _mm256_loadu_ps(data + i);
+                auto scaled = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(value, levels)));
+                auto truncated = _mm256_add_ps(_mm256_mul_ps(scaled, invLevels), zero);
+                auto passThrough = _mm256_cmp_ps(_mm256_andnot_ps(signMask, value), limit, _CMP_NLT_UQ);
+                _mm256_storeu_ps(data + i, _mm256_blendv_ps(truncated, value, passThrough));
+            }
+        }
+#endif
+
+#if JUCE_USE_SSE_INTRINSICS
+        {
+            const auto levels = _mm_set1_ps(qLevels);
+            const auto invLevels = _mm_set1_ps(invQLevels);
+            const auto limit = _mm_set1_ps(integralLimit);
+            const auto signMask = _mm_set1_ps(-0.0f);
+            const auto zero = _mm_setzero_ps();
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto value = _mm_loadu_ps(data + i);
+                auto scaled = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(value, levels)));
+                auto truncated = _mm_add_ps(_mm_mul_ps(scaled, invLevels), zero);
+                auto passThrough = _mm_cmpnlt_ps(_mm_andnot_ps(signMask, value), limit);
+                _mm_storeu_ps(data + i, _mm_or_ps(_mm_and_ps(passThrough, value), _mm_andnot_ps(passThrough, truncated)));
+            }
+        }
+#endif
+
+        for (; i < numSamples; ++i)
+            data[i] = Decimator::quantizeSample(data[i], qLevels, invQLevels);
+    }
+}
+
+void Decimator::prepare(int numChannels)
+{
+    mChannelStates.resize((size_t)juce::jmax(0, numChannels));
+    reset();
+}
+
+void Decimator::reset()
+{
+    for (auto& state : mChannelStates)
+        state = {};
+}
+
+template <int BitDepth>
+void Decimator::quantizeKernel(ChannelState& state, float* channelData, int numSamples, int)
+{
+    state.holdCounter = 0;
+
+    constexpr float qLevels = (float)(1 << BitDepth);
+    quantizeSpan(channelData, numSamples, qLevels, 1.0f / qLevels);
+}
+
+template <int BitDepth>
+void Decimator::holdKernel(ChannelState& state, float* channelData, int numSamples, int rateDivide)
+{
+    constexpr float qLevels = (float)(1 << BitDepth);
+
+    //A run left over from a longer hold ends as soon as the rate goes up
+    if (state.holdCounter >= rateDivide)
+        state.holdCounter = 0;
+
+    //Only the first sample of every hold run is kept, so only those get quantized.
+    //The rest of the run is a plain fill with the held value.
+    int i = 0;
+    while (i < numSamples)
+    {
+        if (state.holdCounter == 0)
+        {
+            state.heldValue = channelData[i];
+            quantizeSpan(&state.heldValue, 1, qLevels, 1.0f / qLevels);
+        }
+
+        const int runLength = juce::jmin(rateDivide - state.holdCounter, numSamples - i);
+        juce::FloatVectorOperations::fill(channelData + i, state.heldValue, runLength);
+
+        state.holdCounter = (state.holdCounter + runLength) % rateDivide;
+        i += runLength;
+    }
+}
+
+//Laid out as { quantize only, quantize + hold } for every bit depth in turn
+template <int... Offsets>
+std::array<Decimator::Kernel, 2 * sizeof...(Offsets)> Decimator::makeKernelTable(std::integer_sequence<int, Offsets...>)
+{
+    std::array<Kernel, 2 * sizeof...(Offsets)> table{};
+    const Kernel quantizeKernels[] = { &quantizeKernel<minBitDepth + Offsets>... };
+    const Kernel holdKernels[] = { &holdKernel<minBitDepth + Offsets>... };
+
+    for (size_t i = 0; i < sizeof...(Offsets); ++i)
+    {
+        table[2 * i] = quantizeKernels[i];
+        table[2 * i + 1] = holdKernels[i];
+    }
+
+    return table;
+}
+
+Decimator::Kernel Decimator::getKernel(int bitDepth, int rateDivide)
+{
+    static const auto kernels = makeKernelTable(std::make_integer_sequence<int, maxBitDepth - minBitDepth + 1>());
+
+    const auto depthIndex = (size_t)(juce::jlimit(minBitDepth, maxBitDepth, bitDepth) - minBitDepth);
+    return kernels[2 * depthIndex + (rateDivide > 1 ? 1 : 0)];
+}
+
+void Decimator::setParameters(int bitDepth, int rateDivide)
+{
+    mRateDivide = juce::jmax(1, rateDivide);
+    mKernel = getKernel(bitDepth, mRateDivide);
+}
+
+void Decimator::process(int channel, float* channelData, int numSamples)
+{
+    jassert(juce::isPositiveAndBelow(channel, (int)mChannelStates.size()));
+    jassert(mKernel != nullptr); //setParameters has to be called first
+
+    mKernel(mChannelStates[(size_t)channel], channelData, numSamples, mRateDivide);
+}
+
+void Decimator::skip(int numSamples)
+{
+    for (auto& state : mChannelStates)
+    {
+        //A run left over from a longer hold ends as soon as the rate goes up
+        const int holdCounter = state.holdCounter < mRateDivide ? state.holdCounter : 0;
+        state.holdCounter = (holdCounter + numSamples) % mRateDivide;
+    }
+}
+
+void Decimator::process(ChannelState& state, float* channelData, int numSamples, int bitDepth, int rateDivide)
+{
+    rateDivide = juce::jmax(1, rateDivide);
+    getKernel(bitDepth, rateDivide)(state, channelData, numSamples, rateDivide);
+}
+
+void Decimator::quantize(float* data, int numSamples, float qLevels, float invQLevels)
+{
+    quantizeSpan(data, numSamples, qLevels, invQLevels);
+}
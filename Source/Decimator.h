@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Decimator.h
+
+    Block based bit-crush + sample-and-hold. Works on whole channel spans
+    instead of one sample at a time, and keeps the hold phase per channel
+    so a held value carries over into the next block.
+
+    Every supported bit depth has its own kernel with the quantization step
+    folded in at compile time, plus a separate variant for the case where
+    no rate reduction happens. setParameters() picks one from a table, so
+    the choice is made once per block rather than per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+class Decimator
+{
+public:
+    static constexpr int minBitDepth = 4;
+    static constexpr int maxBitDepth = 16;
+
+    void prepare(int numChannels);
+    void reset();
+
+    //bitDepth is clamped to [minBitDepth, maxBitDepth].
+    //rateDivide is the number of host samples each held value lasts.
+    void setParameters(int bitDepth, int rateDivide);
+
+    void process(int channel, float* channelData, int numSamples);
+
+    //Moves every channel's hold phase on by numSamples without touching any samples,
+    //the way process() would have left it
+    void skip(int numSamples);
+
+    //Truncates every sample towards zero onto the 2^bitDepth grid.
+    //Bit-exact with value - fmodf(value, 1 / 2^bitDepth).
+    static void quantize(float* data, int numSamples, float qLevels, float invQLevels);
+
+    //quantize() for one sample, for kernels that work sample by sample.
+    //Values at or above 2^23 / qLevels are already on the grid and pass through.
+    static float quantizeSample(float value, float qLevels, float invQLevels)
+    {
+        return std::abs(value) < 8388608.0f * invQLevels ? std::trunc(value * qLevels) * invQLevels + 0.0f : value;
+    }
+
+    //Hold state of one channel
+    struct ChannelState
+    {
+        float heldValue{ 0.0f };
+        int holdCounter{ 0 };
+    };
+
+    //Runs the kernel for these settings on a channel whose state lives elsewhere,
+    //for callers that keep many channels with different settings
+    static void process(ChannelState& state, float* channelData, int numSamples, int bitDepth, int rateDivide);
+
+    //For kernels that do the decimation themselves and keep the hold phase going
+    ChannelState& getChannelState(int channel) { return mChannelStates[(size_t)channel]; }
+
+private:
+    using Kernel = void (*)(ChannelState&, float*, int, int);
+
+    template <int BitDepth>
+    static void quantizeKernel(ChannelState&, float* channelData, int numSamples, int rateDivide);
+
+    template <int BitDepth>
+    static void holdKernel(ChannelState&, float* channelData, int numSamples, int rateDivide);
+
+    template <int... Offsets>
+    static std::array<Kernel, 2 * sizeof...(Offsets)> makeKernelTable(std::integer_sequence<int, Offsets...>);
+
+    static Kernel getKernel(int bitDepth, int rateDivide);
+
+    std::vector<ChannelState> mChannelStates;
+    Kernel mKernel{ nullptr };
+    int mRateDivide{ 1 };
+};
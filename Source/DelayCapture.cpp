@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    DelayCapture.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayCapture.h"
+
+namespace
+{
+    std::unique_ptr<juce::AudioFormatWriter> createWriter(const juce::File& file, int numChannels, double sampleRate)
+    {
+        file.deleteFile();
+        auto stream = file.createOutputStream(DelayCapture::writeBufferSize);
+
+        if (stream == nullptr)
+            return {};
+
+        const bool flac = file.hasFileExtension("flac");
+        std::unique_ptr<juce::AudioFormat> format;
+
+        if (flac)
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            format = std::make_unique<juce::WavAudioFormat>();
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels,
+                                                                                flac ? 24 : 32, {}, 0));
+
+        if (writer != nullptr)
+            stream.release(); //the writer owns the stream now
+
+        return writer;
+    }
+}
+
+DelayCapture::DelayCapture() = default;
+
+DelayCapture::~DelayCapture()
+{
+    stop();
+    mThread.stopThread(-1);
+}
+
+void DelayCapture::prepare(int numChannels, double sampleRate)
+{
+    const juce::ScopedLock sl(mLock);
+
+    if (numChannels == mNumChannels && sampleRate == mSampleRate)
+        return;
+
+    stopCapture();
+
+    const int capacity = juce::jmax(1, (int)std::ceil(ringSeconds * sampleRate));
+    mNumChannels = numChannels;
+    mSampleRate = sampleRate;
+    mRing.setSize(numChannels * 2, capacity);
+    mRing.clear();
+    mFifo.setTotalSize(capacity);
+    mChannelPointers.assign((size_t)(numChannels * 2), nullptr);
+}
+
+juce::Result DelayCapture::start(const juce::File& wetFile, const juce::File& lineFile)
+{
+    const juce::ScopedLock sl(mLock);
+    stopCapture();
+
+    if (mNumChannels == 0)
+        return juce::Result::fail("The plugin isn't running");
+
+    mWetWriter = createWriter(wetFile, mNumChannels, mSampleRate);
+    mLineWriter = createWriter(lineFile, mNumChannels, mSampleRate);
+
+    if (mWetWriter == nullptr || mLineWriter == nullptr)
+    {
+        const auto failedFile = mWetWriter == nullptr ? wetFile : lineFile;
+        mWetWriter.reset();
+        mLineWriter.reset();
+        return juce::Result::fail("Can't write " + failedFile.getFullPathName());
+    }
+
+    //Only this thread reads while no capture runs, so whatever a late push left
+    //in the ring can be thrown away here
+    mFifo.finishedRead(mFifo.getNumReady());
+    mWrittenFrames = 0;
+    mDroppedFrames = 0;
+    mWriteFailed = false;
+    mCapturing = true;
+
+    if (! mThread.isThreadRunning())
+        mThread.startThread();
+
+    mThread.addTimeSliceClient(this);
+    return juce::Result::ok();
+}
+
+void DelayCapture::stop()
+{
+    const juce::ScopedLock sl(mLock);
+    stopCapture();
+}
+
+void DelayCapture::stopCapture()
+{
+    if (! isCapturing())
+        return;
+
+    mCapturing = false;
+
+    //Waits for a slice that is running, after that the writers belong to this thread
+    mThread.removeTimeSliceClient(this);
+    drain();
+    mWetWriter.reset();
+    mLineWriter.reset();
+}
+
+void DelayCapture::push(const float* const* wet, const float* const* line, int numSamples)
+{
+    if (! isCapturing())
+        return;
+
+    //A chunk goes in whole or not at all, so the files only ever miss whole chunks
+    if (mFifo.getFreeSpace() < numSamples)
+    {
+        mDroppedFrames.fetch_add(numSamples, std::memory_order_relaxed);
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    mFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        mRing.copyFrom(channel, start1, wet[channel], size1);
+        mRing.copyFrom(mNumChannels + channel, start1, line[channel], size1);
+
+        if (size2 > 0)
+        {
+            mRing.copyFrom(channel, start2, wet[channel] + size1, size2);
+            mRing.copyFrom(mNumChannels + channel, start2, line[channel] + size1, size2);
+        }
+    }
+
+    mFifo.finishedWrite(size1 + size2);
+}
+
+void DelayCapture::pushSilence(int numSamples)
+{
+    if (! isCapturing())
+        return;
+
+    if (mFifo.getFreeSpace() < numSamples)
+    {
+        mDroppedFrames.fetch_add(numSamples, std::memory_order_relaxed);
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    mFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int channel = 0; channel < mRing.getNumChannels(); ++channel)
+    {
+        mRing.clear(channel, start1, size1);
+
+        if (size2 > 0)
+            mRing.clear(channel, start2, size2);
+    }
+
+    mFifo.finishedWrite(size1 + size2);
+}
+
+int DelayCapture::useTimeSlice()
+{
+    drain();
+
+    //The ring holds seconds, so a few passes a second keep it far from full
+    return 20;
+}
+
+//Writer thread, or the thread that stops the capture once the writer thread is done
+void DelayCapture::drain()
+{
+    int start1, size1, start2, size2;
+    mFifo.prepareToRead(mFifo.getNumReady(), start1, size1, start2, size2);
+
+    //After a failed write everything is dropped, the files are left as they are
+    const bool firstWritten = writeRange(start1, size1);
+    const bool secondWritten = writeRange(start2, size2);
+
+    if (! (firstWritten && secondWritten))
+        mWriteFailed = true;
+
+    mFifo.finishedRead(size1 + size2);
+}
+
+bool DelayCapture::writeRange(int start, int numSamples)
+{
+    if (numSamples == 0)
+        return true;
+
+    if (! hasWriteFailed())
+    {
+        for (int channel = 0; channel < mRing.getNumChannels(); ++channel)
+            mChannelPointers[(size_t)channel] = mRing.getReadPointer(channel, start);
+
+        const auto* const* wet = mChannelPointers.data();
+        const auto* const* line = wet + mNumChannels;
+
+        if (mWetWriter->writeFromFloatArrays(wet, mNumChannels, numSamples)
+            && mLineWriter->writeFromFloatArrays(line, mNumChannels, numSamples))
+        {
+            mWrittenFrames.fetch_add(numSamples, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    mDroppedFrames.fetch_add(numSamples, std::memory_order_relaxed);
+    return false;
+}
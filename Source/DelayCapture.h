@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    DelayCapture.h
+
+    Prints a live session to disk: the wet signal and what is written into
+    the delay line (decimated input plus feedback) of every channel, to
+    two files. The audio thread copies each chunk into a ring behind a
+    juce::AbstractFifo, which is wait-free for one writer and one reader,
+    and a background thread drains the ring into the files. If the disk
+    falls behind and the ring fills up, chunks are dropped and counted
+    rather than waited for; the files are then that much shorter.
+
+    Files ending in .flac are written as 24-bit FLAC, anything else as
+    32-bit float WAV, which keeps line values above full scale. Writes go
+    through a buffered FileOutputStream.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class DelayCapture : private juce::TimeSliceClient
+{
+public:
+    static constexpr double ringSeconds = 4.0;
+    static constexpr int writeBufferSize = 1 << 18;    //bytes per file stream
+
+    DelayCapture();
+    ~DelayCapture() override;
+
+    //Not on the audio thread. Sizes the ring; a capture that is running carries on
+    //unless the channel count or the sample rate changed, then it is stopped.
+    void prepare(int numChannels, double sampleRate);
+
+    //Message thread. Opens both files (replacing them) and starts capturing.
+    juce::Result start(const juce::File& wetFile, const juce::File& lineFile);
+
+    //Message thread. Writes what is left in the ring and closes the files.
+    void stop();
+
+    bool isCapturing() const { return mCapturing.load(std::memory_order_relaxed); }
+
+    //Audio thread: numSamples of every channel's wet signal and delay line input
+    void push(const float* const* wet, const float* const* line, int numSamples);
+
+    //Audio thread: numSamples of silence, for chunks where the delay line is asleep
+    void pushSilence(int numSamples);
+
+    //Frames of the current or last capture that reached the files, and frames
+    //dropped because the ring was full or a write failed
+    juce::int64 getWrittenFrames() const { return mWrittenFrames.load(std::memory_order_relaxed); }
+    juce::int64 getDroppedFrames() const { return mDroppedFrames.load(std::memory_order_relaxed); }
+    bool hasWriteFailed() const { return mWriteFailed.load(std::memory_order_relaxed); }
+
+private:
+    int useTimeSlice() override;
+    void stopCapture();
+    void drain();
+    bool writeRange(int start, int numSamples);
+
+    //Start, stop and prepare; never taken by the audio thread
+    juce::CriticalSection mLock;
+
+    std::atomic<bool> mCapturing{ false };
+    std::atomic<bool> mWriteFailed{ false };
+    std::atomic<juce::int64> mWrittenFrames{ 0 };
+    std::atomic<juce::int64> mDroppedFrames{ 0 };
+
+    int mNumChannels{ 0 };
+    double mSampleRate{ 0.0 };
+    juce::AbstractFifo mFifo{ 1 };
+    //The wet channels, then the line channels
+    juce::AudioBuffer<float> mRing;
+    std::vector<const float*> mChannelPointers;
+
+    //Only used by the writer thread while capturing
+    std::unique_ptr<juce::AudioFormatWriter> mWetWriter;
+    std::unique_ptr<juce::AudioFormatWriter> mLineWriter;
+    juce::TimeSliceThread mThread{ "BitDelay capture" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayCapture)
+};
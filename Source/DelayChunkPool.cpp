@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    DelayChunkPool.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayChunkPool.h"
+
+DelayChunkPool::DelayChunkPool()
+{
+    mFreeChunks.reserve(maxFreeChunks);
+    mThread.startThread();
+}
+
+DelayChunkPool::~DelayChunkPool()
+{
+    mThread.stopThread(-1);
+}
+
+float* DelayChunkPool::acquire()
+{
+    {
+        const juce::ScopedLock sl(mLock);
+
+        if (! mFreeChunks.empty())
+        {
+            auto* chunk = mFreeChunks.back().release();
+            mFreeChunks.pop_back();
+            juce::FloatVectorOperations::clear(chunk, chunkLength);
+            return chunk;
+        }
+    }
+
+    auto* chunk = new float[chunkLength];
+    juce::FloatVectorOperations::clear(chunk, chunkLength);
+    return chunk;
+}
+
+void DelayChunkPool::release(float* chunk)
+{
+    std::unique_ptr<float[]> owned(chunk);
+    const juce::ScopedLock sl(mLock);
+
+    if ((int)mFreeChunks.size() < maxFreeChunks)
+        mFreeChunks.push_back(std::move(owned));
+}
+
+void DelayChunkPool::addClient(juce::TimeSliceClient* client)
+{
+    mThread.addTimeSliceClient(client);
+}
+
+void DelayChunkPool::removeClient(juce::TimeSliceClient* client)
+{
+    mThread.removeTimeSliceClient(client);
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    DelayChunkPool.h
+
+    Fixed-size blocks of delay memory shared by every PooledDelayLine in the
+    process, plus the background thread that hands them out. Lines only
+    take and return chunks from that thread (or the message thread), so the
+    lock here is never touched by audio code.
+
+    Released chunks are kept for reuse up to maxFreeChunks, beyond that
+    they go back to the system.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class DelayChunkPool
+{
+public:
+    static constexpr int chunkShift = 15;
+    static constexpr int chunkLength = 1 << chunkShift;    //frames per chunk
+    static constexpr int maxFreeChunks = 64;
+
+    DelayChunkPool();
+    ~DelayChunkPool();
+
+    //A chunk of chunkLength silent floats
+    float* acquire();
+    void release(float* chunk);
+
+    //Clients get their time slices on the pool's thread. removeClient waits
+    //if the client's slice is running.
+    void addClient(juce::TimeSliceClient* client);
+    void removeClient(juce::TimeSliceClient* client);
+
+private:
+    juce::CriticalSection mLock;
+    std::vector<std::unique_ptr<float[]>> mFreeChunks;
+    juce::TimeSliceThread mThread{ "BitDelay delay pool" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayChunkPool)
+};
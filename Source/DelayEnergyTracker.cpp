@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    DelayEnergyTracker.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayEnergyTracker.h"
+
+float DelayEnergyTracker::getPeak(const float* data, int numSamples)
+{
+    const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return juce::jmax(-range.getStart(), range.getEnd());
+}
+
+float DelayEnergyTracker::getPeak(const double* data, int numSamples)
+{
+    const auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return (float)juce::jmax(-range.getStart(), range.getEnd());
+}
+
+void DelayEnergyTracker::addBlock(float peak, int numSamples)
+{
+    //Saturates instead of overflowing during long silences
+    if (isSilent(peak))
+        mSilentFrames = (int)juce::jmin((juce::int64)std::numeric_limits<int>::max(), (juce::int64)mSilentFrames + numSamples);
+    else
+        mSilentFrames = 0;
+}
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    DelayEnergyTracker.h
+
+    Keeps track of how long everything written into a delay line has stayed
+    below silenceThreshold. Once that covers the whole line, every tap reads
+    silence, so with silent input the delay can't produce anything audible
+    and processing can be skipped.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class DelayEnergyTracker
+{
+public:
+    //-80 dBFS, also where getTailLengthSeconds considers an echo gone
+    static constexpr float silenceThreshold = 1.0e-4f;
+
+    static float getPeak(const float* data, int numSamples);
+    static float getPeak(const double* data, int numSamples);
+    static bool isSilent(float peak) { return peak < silenceThreshold; }
+
+    //Starts out as if the line held sound, it has to prove it is silent first
+    void reset() { mSilentFrames = 0; }
+
+    //peak is the largest magnitude written into the line over numSamples frames
+    void addBlock(float peak, int numSamples);
+
+    //lineLength is how many frames the line currently holds
+    bool isLineSilent(int lineLength) const { return mSilentFrames >= lineLength; }
+
+private:
+    int mSilentFrames{ 0 };
+};
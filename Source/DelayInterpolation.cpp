@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    DelayInterpolation.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayInterpolation.h"
+#include "InterleavedDelay.h"
+
+namespace DelayInterpolation
+{
+    namespace
+    {
+        //frames points at the first frame the mode needs (getFramesBefore() frames before
+        //the tap), the rest follow contiguously
+        template <int Lanes>
+        forcedinline void readFrame(Mode mode, const float* frames, float fraction, float* dest, float* allpassState)
+        {
+            switch (mode)
+            {
+                case Mode::none:
+                    for (int lane = 0; lane < Lanes; ++lane)
+                        dest[lane] = frames[lane];
+                    break;
+
+                case Mode::linear:
+                    for (int lane = 0; lane < Lanes; ++lane)
+                        dest[lane] = frames[lane] + (frames[Lanes + lane] - frames[lane]) * fraction;
+                    break;
+
+                case Mode::cubic:
+                {
+                    float w[4];
+                    getCubicWeights(fraction, w);
+                    for (int lane = 0; lane < Lanes; ++lane)
+                        dest[lane] = frames[lane] * w[0] + frames[Lanes + lane] * w[1]
+                                   + frames[2 * Lanes + lane] * w[2] + frames[3 * Lanes + lane] * w[3];
+                    break;
+                }
+
+                case Mode::allpass:
+                {
+                    //Delay of (1 - fraction) behind the newer sample
+                    const float eta = fraction / (2.0f - fraction);
+                    for (int lane = 0; lane < Lanes; ++lane)
+                    {
+                        dest[lane] = eta * (frames[Lanes + lane] - allpassState[lane]) + frames[lane];
+                        allpassState[lane] = dest[lane];
+                    }
+                    break;
+                }
+            }
+        }
+
+        //Steady tap: the weights are fixed, so each tap is a scaled contiguous run
+        template <int Lanes>
+        void readContiguous(Mode mode, const float* frames, float fraction, float* dest, int numSamples)
+        {
+            const int numFloats = numSamples * Lanes;
+
+            switch (mode)
+            {
+                case Mode::none:
+                    juce::FloatVectorOperations::copy(dest, frames, numFloats);
+                    break;
+
+                case Mode::linear:
+                    juce::FloatVectorOperations::copyWithMultiply(dest, frames, 1.0f - fraction, numFloats);
+                    juce::FloatVectorOperations::addWithMultiply(dest, frames + Lanes, fraction, numFloats);
+                    break;
+
+                case Mode::cubic:
+                {
+                    float w[4];
+                    getCubicWeights(fraction, w);
+                    juce::FloatVectorOperations::copyWithMultiply(dest, frames, w[0], numFloats);
+                    juce::FloatVectorOperations::addWithMultiply(dest, frames + Lanes, w[1], numFloats);
+                    juce::FloatVectorOperations::addWithMultiply(dest, frames + 2 * Lanes, w[2], numFloats);
+                    juce::FloatVectorOperations::addWithMultiply(dest, frames + 3 * Lanes, w[3], numFloats);
+                    break;
+                }
+
+                case Mode::allpass:
+                    jassertfalse; //recursive, goes through readFrame
+                    break;
+            }
+        }
+    }
+
+    int getFramesBefore(Mode mode)
+    {
+        return mode == Mode::cubic ? 1 : 0;
+    }
+
+    int getFramesPerTap(Mode mode)
+    {
+        return mode == Mode::none ? 1 : (mode == Mode::cubic ? 4 : 2);
+    }
+
+    int getMinimumDelay(Mode mode)
+    {
+        return getFramesPerTap(mode) - getFramesBefore(mode);
+    }
+
+    template <int Lanes>
+    void readTap(Mode mode, const float* frames, float fraction, float* dest, float* allpassState)
+    {
+        readFrame<Lanes>(mode, frames, fraction, dest, allpassState);
+    }
+
+    template <int Lanes>
+    void readSteady(Mode mode, const float* window, float fraction, float* dest, int numSamples, float* allpassState)
+    {
+        if (mode != Mode::allpass)
+        {
+            readContiguous<Lanes>(mode, window, fraction, dest, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            readFrame<Lanes>(mode, window + i * Lanes, fraction, dest + i * Lanes, allpassState);
+    }
+
+    void getTapPosition(Mode mode, int writePosition, double delaySamples, int lengthMask, int& index, float& fraction)
+    {
+        delaySamples = juce::jmax(delaySamples, (double)getMinimumDelay(mode));
+
+        //none reads the frame before the exact position, as the original plugin did
+        const double position = (double)writePosition - delaySamples;
+        const double whole = std::floor(position);
+        index = (int)whole & lengthMask;
+        fraction = mode == Mode::none ? 0.0f : (float)(position - whole);
+    }
+
+    void fillTapPositions(Mode mode, int writePosition, const float* delayTimes, double sampleRate,
+                          int lengthMask, int* indices, float* fractions, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            getTapPosition(mode, writePosition + i, sampleRate * delayTimes[i], lengthMask, indices[i], fractions[i]);
+    }
+
+    template <int Lanes>
+    void read(Mode mode, const DelayLine& delayLine, int channel, const TapPositions& taps,
+              float* dest, int numSamples, float* allpassState)
+    {
+        const int framesBefore = getFramesBefore(mode);
+
+        if (taps.indices != nullptr)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                readFrame<Lanes>(mode, delayLine.getReadPointer(channel, taps.indices[i] - framesBefore),
+                                 taps.fractions[i], dest + i * Lanes, allpassState);
+            return;
+        }
+
+        //The whole block of taps and its neighbours is one contiguous window thanks to the guard region
+        readSteady<Lanes>(mode, delayLine.getReadPointer(channel, taps.startIndex - framesBefore),
+                          taps.fraction, dest, numSamples, allpassState);
+    }
+
+    template void read<1>(Mode, const DelayLine&, int, const TapPositions&, float*, int, float*);
+    template void read<InterleavedDelay::numLanes>(Mode, const DelayLine&, int, const TapPositions&, float*, int, float*);
+    template void readTap<1>(Mode, const float*, float, float*, float*);
+    template void readSteady<1>(Mode, const float*, float, float*, int, float*);
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    DelayInterpolation.h
+
+    Fractional reads from a DelayLine. A block of taps is read in one go:
+    with a steady delay time every tap shares one fraction, so the
+    interpolation weights are computed once and applied to one contiguous
+    window of the delay line; while the time moves, each tap has its own
+    index and fraction.
+
+    Lanes is the number of interleaved channels per frame (1 for a plain
+    channel, InterleavedDelay::numLanes for packed groups). All lanes of a
+    frame share the same tap position.
+
+    Rough cost per tap, relative to None: Linear 2 multiply-adds, Cubic
+    (4-point Hermite) 4, Allpass (first order Thiran) 3 but serial, since
+    it is recursive and keeps one state value per lane.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayLine.h"
+
+namespace DelayInterpolation
+{
+    enum class Mode
+    {
+        none,       //the whole frame before the exact read position, like the original plugin
+        linear,
+        cubic,
+        allpass
+    };
+
+    static constexpr int numModes = 4;
+
+    //Where a block of taps reads from. indices is nullptr while the delay time is
+    //steady, then the taps start at startIndex and all use the same fraction.
+    struct TapPositions
+    {
+        const int* indices{ nullptr };
+        const float* fractions{ nullptr };
+        int startIndex{ 0 };
+        float fraction{ 0.0f };
+    };
+
+    //Shortest delay, in samples, whose tap only reads frames written before the
+    //current one. Shorter delays are raised to it, so feedback stays causal.
+    int getMinimumDelay(Mode mode);
+
+    //Tap position delaySamples behind writePosition, split into an index wrapped with
+    //lengthMask (the delay storage's power-of-two length - 1) and a fraction
+    void getTapPosition(Mode mode, int writePosition, double delaySamples, int lengthMask, int& index, float& fraction);
+
+    //Per-sample tap positions for a delay that changes every sample
+    void fillTapPositions(Mode mode, int writePosition, const float* delayTimes, double sampleRate,
+                          int lengthMask, int* indices, float* fractions, int numSamples);
+
+    //Reads numSamples frames of one delay line channel into dest. allpassState
+    //holds Lanes values and is only used (and updated) in allpass mode.
+    template <int Lanes>
+    void read(Mode mode, const DelayLine& delayLine, int channel, const TapPositions& taps,
+              float* dest, int numSamples, float* allpassState);
+
+    //Frames a tap needs before its own position, and in total, for delay storage
+    //that has to be expanded to floats before reading
+    int getFramesBefore(Mode mode);
+    int getFramesPerTap(Mode mode);
+
+    //4-point Hermite weights for taps at -1, 0, 1, 2
+    forcedinline void getCubicWeights(float x, float* w)
+    {
+        const float x2 = x * x;
+        const float x3 = x2 * x;
+        w[0] = -0.5f * x + x2 - 0.5f * x3;
+        w[1] = 1.0f - 2.5f * x2 + 1.5f * x3;
+        w[2] = 0.5f * x + 2.0f * x2 - 1.5f * x3;
+        w[3] = -0.5f * x2 + 0.5f * x3;
+    }
+
+    //One tap from frames, which starts getFramesBefore() frames before the tap
+    template <int Lanes>
+    void readTap(Mode mode, const float* frames, float fraction, float* dest, float* allpassState);
+
+    //numSamples taps with a steady delay from a window that starts getFramesBefore()
+    //frames before the first tap and is getFramesPerTap() - 1 frames longer than the block
+    template <int Lanes>
+    void readSteady(Mode mode, const float* window, float fraction, float* dest, int numSamples, float* allpassState);
+}
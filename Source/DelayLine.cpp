@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    DelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayLine.h"
+
+void DelayLine::prepare(int numChannels, int minimumLength, int maxWindowLength, int lanes)
+{
+    mNumChannels = juce::jmax(0, numChannels);
+    mLanes = juce::jmax(1, lanes);
+    mLength = juce::nextPowerOfTwo(juce::jmax(1, minimumLength));
+    mGuardLength = juce::jmin(mLength, juce::jmax(1, maxWindowLength) + interpolationPadding);
+    mChannelStride = (size_t)(mLength + mGuardLength) * (size_t)mLanes;
+
+    mData.assign((size_t)mNumChannels * mChannelStride, 0.0f);
+}
+
+void DelayLine::clear()
+{
+    std::fill(mData.begin(), mData.end(), 0.0f);
+}
+
+void DelayLine::write(int channel, int position, const float* source, int numFrames)
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    jassert(numFrames <= mGuardLength);
+
+    position = wrap(position);
+    auto* data = mData.data() + (size_t)channel * mChannelStride;
+    const auto lanes = (size_t)mLanes;
+
+    //The window can run into the guard region, which is a valid copy of the line's start
+    juce::FloatVectorOperations::copy(data + (size_t)position * lanes, source, numFrames * mLanes);
+
+    //The part that landed in the guard also belongs at the start of the line...
+    const int numPastEnd = position + numFrames - mLength;
+    if (numPastEnd > 0)
+        juce::FloatVectorOperations::copy(data, data + (size_t)mLength * lanes, numPastEnd * mLanes);
+
+    //...and whatever was written to the start is mirrored into the guard
+    if (position < mGuardLength)
+    {
+        const int numToMirror = juce::jmin(position + numFrames, mGuardLength) - position;
+        juce::FloatVectorOperations::copy(data + (size_t)(mLength + position) * lanes, data + (size_t)position * lanes, numToMirror * mLanes);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+
+    Circular delay storage for one or more channels. The capacity is rounded
+    up to a power of two, so positions wrap with a mask instead of %, and
+    every channel carries a guard region after its end that mirrors its
+    first frames. A window of up to getGuardLength() frames starting at any
+    wrapped position is therefore contiguous in memory: reads never split
+    at the wrap point and writes only need a short mirror copy.
+
+    A frame is `lanes` floats, one per interleaved channel (1 for a plain
+    channel, InterleavedDelay::numLanes for packed groups).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+class DelayLine
+{
+public:
+    //Frames each window can reach past its block for interpolation neighbours
+    static constexpr int interpolationPadding = 4;
+
+    //Holds at least minimumLength frames per channel, windows can be up to
+    //maxWindowLength (+ interpolationPadding) frames long
+    void prepare(int numChannels, int minimumLength, int maxWindowLength, int lanes = 1);
+    void clear();
+
+    int getNumChannels() const  { return mNumChannels; }
+    int getLength() const       { return mLength; }
+    int getMask() const         { return mLength - 1; }
+    int getGuardLength() const  { return mGuardLength; }
+
+    //Any integer position, negative ones included, onto [0, getLength())
+    int wrap(int position) const { return position & (mLength - 1); }
+
+    //Copies numFrames frames to position (wrapped), keeping the guard region in sync
+    void write(int channel, int position, const float* source, int numFrames);
+
+    //Start of the contiguous window beginning at position (wrapped). The
+    //window may run up to getGuardLength() frames past the end of the line.
+    const float* getReadPointer(int channel, int position) const
+    {
+        return mData.data() + (size_t)channel * mChannelStride + (size_t)wrap(position) * (size_t)mLanes;
+    }
+
+    //Start of a channel's storage, for kernels that write frame by frame. Frames
+    //written below getGuardLength() have to be copied to getLength() + position too.
+    float* getChannelPointer(int channel)
+    {
+        return mData.data() + (size_t)channel * mChannelStride;
+    }
+
+private:
+    int mNumChannels{ 0 };
+    int mLength{ 1 };
+    int mGuardLength{ 0 };
+    int mLanes{ 1 };
+    size_t mChannelStride{ 0 };
+    std::vector<float> mData;   //[channel][length + guard][lane]
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    DspStats.cpp
+
+  ==============================================================================
+*/
+
+#include "DspStats.h"
+
+double DspStats::Snapshot::getAverageLoad() const
+{
+    if (numSamples == 0 || sampleRate <= 0.0)
+        return 0.0;
+
+    return (double)totalNanoseconds * 1.0e-9 * sampleRate / (double)numSamples;
+}
+
+double DspStats::Snapshot::getNanosecondsPerSample() const
+{
+    return numSamples > 0 ? (double)totalNanoseconds / (double)numSamples : 0.0;
+}
+
+double DspStats::Snapshot::getCyclesPerSample() const
+{
+    return numSamples > 0 ? (double)totalCycles / (double)numSamples : 0.0;
+}
+
+//Counts time stamps against the high resolution clock for a tenth of a millisecond,
+//which is accurate to a fraction of a percent and short enough for every prepareToPlay
+double DspStats::measureNanosecondsPerTimestamp()
+{
+    if (! hasCycleCounter)
+        return 1.0e9 / (double)juce::Time::getHighResolutionTicksPerSecond();
+
+    const auto ticksPerSecond = (double)juce::Time::getHighResolutionTicksPerSecond();
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    const auto startTimestamp = readTimestamp();
+    auto ticks = startTicks;
+
+    while ((double)(ticks - startTicks) < 1.0e-4 * ticksPerSecond)
+        ticks = juce::Time::getHighResolutionTicks();
+
+    const auto timestamps = (double)(readTimestamp() - startTimestamp);
+    return timestamps > 0.0 ? (double)(ticks - startTicks) * 1.0e9 / ticksPerSecond / timestamps : 1.0;
+}
+
+void DspStats::prepare(double sampleRate)
+{
+    mSampleRate.store(sampleRate, std::memory_order_relaxed);
+    mNanosecondsPerTimestamp = measureNanosecondsPerTimestamp();
+    mResetRequested.store(false, std::memory_order_relaxed);
+    clear();
+}
+
+void DspStats::clear()
+{
+    for (auto* counter : { &mNumBlocks, &mNumSamples, &mTotalNanoseconds, &mTotalCycles, &mWorstNanoseconds, &mNumOverruns })
+        counter->store(0, std::memory_order_relaxed);
+
+    for (auto& bin : mBlockSizes)
+        bin.store(0, std::memory_order_relaxed);
+
+    mWorstBlockSize.store(0, std::memory_order_relaxed);
+    mPeakLoad.store(0.0f, std::memory_order_relaxed);
+}
+
+void DspStats::addBlock(int numSamples, juce::uint64 elapsed)
+{
+    if (mResetRequested.load(std::memory_order_relaxed))
+    {
+        mResetRequested.store(false, std::memory_order_relaxed);
+        clear();
+    }
+
+    if (numSamples <= 0)
+        return;
+
+    const auto nanoseconds = (juce::uint64)((double)elapsed * mNanosecondsPerTimestamp);
+
+    increase(mNumBlocks, 1);
+    increase(mNumSamples, (juce::uint64)numSamples);
+    increase(mTotalNanoseconds, nanoseconds);
+    increase(mTotalCycles, hasCycleCounter ? elapsed : 0);
+
+    if (nanoseconds > mWorstNanoseconds.load(std::memory_order_relaxed))
+    {
+        mWorstNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+        mWorstBlockSize.store(numSamples, std::memory_order_relaxed);
+    }
+
+    const double blockNanoseconds = (double)numSamples * 1.0e9 / mSampleRate.load(std::memory_order_relaxed);
+    const auto load = (float)((double)nanoseconds / blockNanoseconds);
+
+    if (load > mPeakLoad.load(std::memory_order_relaxed))
+        mPeakLoad.store(load, std::memory_order_relaxed);
+
+    if (load > 1.0f)
+        increase(mNumOverruns, 1);
+
+    const int bin = juce::jmin(numSizeBins - 1, juce::findHighestSetBit((juce::uint32)numSamples));
+    increase(mBlockSizes[(size_t)bin], 1);
+}
+
+DspStats::Snapshot DspStats::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.sampleRate = mSampleRate.load(std::memory_order_relaxed);
+    snapshot.numBlocks = mNumBlocks.load(std::memory_order_relaxed);
+    snapshot.numSamples = mNumSamples.load(std::memory_order_relaxed);
+    snapshot.totalNanoseconds = mTotalNanoseconds.load(std::memory_order_relaxed);
+    snapshot.totalCycles = mTotalCycles.load(std::memory_order_relaxed);
+    snapshot.worstNanoseconds = mWorstNanoseconds.load(std::memory_order_relaxed);
+    snapshot.worstBlockSize = mWorstBlockSize.load(std::memory_order_relaxed);
+    snapshot.peakLoad = mPeakLoad.load(std::memory_order_relaxed);
+    snapshot.numOverruns = mNumOverruns.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < numSizeBins; ++i)
+        snapshot.blockSizes[(size_t)i] = mBlockSizes[(size_t)i].load(std::memory_order_relaxed);
+
+    return snapshot;
+}
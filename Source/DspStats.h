@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    DspStats.h
+
+    Records what processBlock costs: time and cycle counts per block, the
+    worst block, how often a block took longer than the audio it produced
+    (an overrun, which on its own would make the host drop out) and a
+    histogram of the block sizes the host sends.
+
+    The audio thread is the only writer. Every counter is its own relaxed
+    atomic, so recording is wait-free and readers on other threads never
+    block it; a snapshot taken while a block is being recorded may mix
+    that block's counters with the previous ones. Recording costs two
+    time stamp counter reads and a dozen stores per block.
+
+    Build with BITDELAY_DSP_STATS=0 to compile the recording out, the
+    counters then stay at zero.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#ifndef BITDELAY_DSP_STATS
+ #define BITDELAY_DSP_STATS 1
+#endif
+
+class DspStats
+{
+public:
+    static constexpr bool enabled = BITDELAY_DSP_STATS != 0;
+
+    //Bin i counts blocks of 2^i up to 2^(i+1)-1 samples, the last bin everything bigger
+    static constexpr int numSizeBins = 16;
+
+    struct Snapshot
+    {
+        double sampleRate{ 0.0 };
+        juce::uint64 numBlocks{ 0 };
+        juce::uint64 numSamples{ 0 };
+        juce::uint64 totalNanoseconds{ 0 };
+        juce::uint64 totalCycles{ 0 };          //time stamp counter ticks, 0 where there is none
+        juce::uint64 worstNanoseconds{ 0 };
+        int worstBlockSize{ 0 };                //samples in the block that took worstNanoseconds
+        float peakLoad{ 0.0f };                 //highest processing time / block duration
+        juce::uint64 numOverruns{ 0 };          //blocks with a load above 1
+        std::array<juce::uint64, numSizeBins> blockSizes{};
+
+        //Processing time over the duration of all recorded audio
+        double getAverageLoad() const;
+        double getNanosecondsPerSample() const;
+        double getCyclesPerSample() const;
+
+        //Smallest block size counted in bin
+        static int getBinStart(int bin) { return 1 << bin; }
+    };
+
+    //Sets the rate loads are measured against and clears the counters.
+    //Call while processBlock isn't running, e.g. from prepareToPlay.
+    void prepare(double sampleRate);
+
+    //Any thread: the counters are cleared at the start of the next recorded block
+    void requestReset() { mResetRequested.store(true, std::memory_order_relaxed); }
+
+    //Any thread
+    Snapshot getSnapshot() const;
+
+    //Audio thread: one processed block that took elapsed readTimestamp() units
+    void addBlock(int numSamples, juce::uint64 elapsed);
+
+    //The time stamp counter where there is one (a few cycles to read), the
+    //high resolution clock elsewhere. prepare() measures how fast it runs.
+    static constexpr bool hasCycleCounter = JUCE_INTEL != 0;
+
+    static juce::uint64 readTimestamp()
+    {
+       #if JUCE_INTEL
+        return (juce::uint64)__rdtsc();
+       #else
+        return (juce::uint64)juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    //Times the enclosing scope and records it as one block
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock(DspStats& statsToUse, int numSamplesInBlock)
+            : stats(statsToUse), numSamples(numSamplesInBlock), start(readTimestamp())
+        {
+        }
+
+        ~ScopedBlock()
+        {
+            stats.addBlock(numSamples, readTimestamp() - start);
+        }
+
+    private:
+        DspStats& stats;
+        const int numSamples;
+        const juce::uint64 start;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+    };
+
+private:
+    static double measureNanosecondsPerTimestamp();
+    void clear();
+
+    using Counter = std::atomic<juce::uint64>;
+
+    //Single writer, so a relaxed load and store is enough and cheaper than fetch_add
+    static void increase(Counter& counter, juce::uint64 amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::atomic<double> mSampleRate{ 0.0 };
+    double mNanosecondsPerTimestamp{ 1.0 };
+    std::atomic<bool> mResetRequested{ false };
+
+    Counter mNumBlocks{ 0 };
+    Counter mNumSamples{ 0 };
+    Counter mTotalNanoseconds{ 0 };
+    Counter mTotalCycles{ 0 };
+    Counter mWorstNanoseconds{ 0 };
+    std::atomic<int> mWorstBlockSize{ 0 };
+    std::atomic<float> mPeakLoad{ 0.0f };
+    Counter mNumOverruns{ 0 };
+    std::array<Counter, numSizeBins> mBlockSizes{};
+};
+
+#if BITDELAY_DSP_STATS
+ #define BITDELAY_SCOPED_DSP_STATS(stats, numSamples) DspStats::ScopedBlock bitDelayDspStatsScope(stats, numSamples)
+#else
+ #define BITDELAY_SCOPED_DSP_STATS(stats, numSamples)
+#endif
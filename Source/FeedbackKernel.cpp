@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    FeedbackKernel.cpp
+
+  ==============================================================================
+*/
+
+#include "FeedbackKernel.h"
+
+namespace FeedbackKernel
+{
+    namespace
+    {
+        using Mode = DelayInterpolation::Mode;
+
+        //Where the decimated input comes from: quantized and held in the loop, or
+        //already decimated by the caller (Parameters::decimated)
+        enum class Decimation { hold, given };
+
+        //Everything the loop needs, fixed for the block
+        template <typename SampleType>
+        struct Block
+        {
+            float* line;
+            int length;
+            int mask;
+            int guardLength;
+            int writePosition;
+            SampleType* data;
+            int numSamples;
+            const Parameters* parameters;
+            float qLevels;
+            float invQLevels;
+        };
+
+        //A steady tap computes its weights once, in the same form readSteady() applies them
+        template <Mode M, bool Steady>
+        forcedinline float readTap(const float* frames, float fraction, const float* steadyWeights, float& allpassState)
+        {
+            if (M == Mode::none)
+                return frames[0];
+
+            if (M == Mode::linear)
+                return Steady ? frames[0] * steadyWeights[0] + frames[1] * steadyWeights[1]
+                              : frames[0] + (frames[1] - frames[0]) * fraction;
+
+            if (M == Mode::cubic)
+            {
+                float w[4];
+
+                if (Steady)
+                    std::copy(steadyWeights, steadyWeights + 4, w);
+                else
+                    DelayInterpolation::getCubicWeights(fraction, w);
+
+                return frames[0] * w[0] + frames[1] * w[1] + frames[2] * w[2] + frames[3] * w[3];
+            }
+
+            //Allpass, first order Thiran
+            const float eta = Steady ? steadyWeights[0] : fraction / (2.0f - fraction);
+            allpassState = eta * (frames[1] - allpassState) + frames[0];
+            return allpassState;
+        }
+
+        template <Mode M, bool Steady, Decimation D, typename SampleType>
+        float processBlock(const Block<SampleType>& block, Decimator::ChannelState& decimatorState, float& allpassState)
+        {
+            const auto& parameters = *block.parameters;
+            const auto& taps = parameters.taps;
+            const int framesBefore = DelayInterpolation::getFramesBefore(M);
+            const int rateDivide = juce::jmax(1, parameters.rateDivide);
+
+            float steadyWeights[4] = {};
+
+            if (Steady)
+            {
+                const float fraction = taps.fraction;
+
+                if (M == Mode::linear)
+                {
+                    steadyWeights[0] = 1.0f - fraction;
+                    steadyWeights[1] = fraction;
+                }
+                else if (M == Mode::cubic)
+                {
+                    DelayInterpolation::getCubicWeights(fraction, steadyWeights);
+                }
+                else if (M == Mode::allpass)
+                {
+                    steadyWeights[0] = fraction / (2.0f - fraction);
+                }
+            }
+
+            //A run left over from a longer hold ends as soon as the rate goes up
+            int holdCounter = D == Decimation::hold && decimatorState.holdCounter < rateDivide ? decimatorState.holdCounter : 0;
+            float heldValue = decimatorState.heldValue;
+            float state = allpassState;
+            float peak = 0.0f;
+            int position = block.writePosition & block.mask;
+
+            for (int i = 0; i < block.numSamples; ++i)
+            {
+                const int tapIndex = Steady ? taps.startIndex + i : taps.indices[i];
+                const float fraction = Steady ? 0.0f : taps.fractions[i];
+                const float tap = readTap<M, Steady>(block.line + ((tapIndex - framesBefore) & block.mask),
+                                                     fraction, steadyWeights, state);
+
+                //The input is crushed to at most 16 bits, so it is decimated as a float even when
+                //the host sends doubles; only the dry path keeps the host's precision
+                const SampleType input = block.data[i];
+                const float crushInput = (float)input;
+                float decimated;
+
+                if (D == Decimation::given)
+                {
+                    decimated = parameters.decimated[i];
+                }
+                else
+                {
+                    if (holdCounter == 0)
+                        heldValue = Decimator::quantizeSample(crushInput, block.qLevels, block.invQLevels);
+
+                    decimated = heldValue;
+
+                    if (++holdCounter == rateDivide)
+                        holdCounter = 0;
+                }
+
+                //Decimated input plus feedback goes back into the line, the wet output is the feedback alone
+                const float written = decimated + tap * parameters.feedback[i];
+                block.line[position] = written;
+
+                if (position < block.guardLength)
+                    block.line[block.length + position] = written;
+
+                peak = juce::jmax(peak, std::abs(written));
+                block.data[i] = input * (SampleType)parameters.dry[i] + (SampleType)((written - decimated) * parameters.wet[i]);
+                position = (position + 1) & block.mask;
+            }
+
+            if (D != Decimation::given)
+            {
+                decimatorState.holdCounter = holdCounter;
+                decimatorState.heldValue = heldValue;
+            }
+
+            allpassState = state;
+            return peak;
+        }
+
+        template <Mode M, typename SampleType>
+        float processMode(const Block<SampleType>& block, Decimator::ChannelState& decimatorState, float& allpassState)
+        {
+            const bool steady = block.parameters->taps.indices == nullptr;
+
+            if (block.parameters->decimated != nullptr)
+                return steady ? processBlock<M, true, Decimation::given>(block, decimatorState, allpassState)
+                              : processBlock<M, false, Decimation::given>(block, decimatorState, allpassState);
+
+            return steady ? processBlock<M, true, Decimation::hold>(block, decimatorState, allpassState)
+                          : processBlock<M, false, Decimation::hold>(block, decimatorState, allpassState);
+        }
+    }
+
+    template <typename SampleType>
+    float process(DelayLine& delayLine, int channel, int writePosition, SampleType* channelData, int numSamples,
+                  const Parameters& parameters, Decimator::ChannelState& decimatorState, float& allpassState)
+    {
+        const int bitDepth = juce::jlimit(Decimator::minBitDepth, Decimator::maxBitDepth, parameters.bitDepth);
+        const float qLevels = std::ldexp(1.0f, bitDepth);
+
+        const Block<SampleType> block{ delayLine.getChannelPointer(channel), delayLine.getLength(), delayLine.getMask(),
+                           delayLine.getGuardLength(), writePosition, channelData, numSamples,
+                           &parameters, qLevels, 1.0f / qLevels };
+
+        switch (parameters.interpolation)
+        {
+            case Mode::none:    return processMode<Mode::none>(block, decimatorState, allpassState);
+            case Mode::linear:  return processMode<Mode::linear>(block, decimatorState, allpassState);
+            case Mode::cubic:   return processMode<Mode::cubic>(block, decimatorState, allpassState);
+            case Mode::allpass: return processMode<Mode::allpass>(block, decimatorState, allpassState);
+        }
+
+        return 0.0f;
+    }
+
+    template float process<float>(DelayLine&, int, int, float*, int, const Parameters&, Decimator::ChannelState&, float&);
+    template float process<double>(DelayLine&, int, int, double*, int, const Parameters&, Decimator::ChannelState&, float&);
+}
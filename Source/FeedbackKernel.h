@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    FeedbackKernel.h
+
+    The per-channel delay pipeline fused into one pass. For every sample it
+    reads the tap, decimates the input, writes decimated input plus feedback
+    back into the line and mixes dry and wet, so the channel is traversed
+    once instead of once per stage, and a tap shorter than the block hears
+    the feedback written a few samples earlier.
+
+    Works on a float DelayLine, with float or double host buffers. The arithmetic is the same as the blockwise
+    stages (DelayInterpolation::read, Decimator, the add/subtract/mix in
+    BitDelayAudioProcessor::processChunk), so the output matches them
+    whenever the delay is longer than the block.
+
+    The loop only does sample-and-hold itself, quantizing the first sample
+    of each run with a runtime step. Input that is quantized at full rate
+    (rate divide 1) or band-limited is better decimated ahead of the loop,
+    by Decimator's per-depth SIMD kernels or DecimationFilter, and passed
+    in as Parameters::decimated; the callers in this repo do that.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Decimator.h"
+#include "DelayInterpolation.h"
+#include "DelayLine.h"
+
+namespace FeedbackKernel
+{
+    struct Parameters
+    {
+        const float* feedback;      //per sample
+        const float* dry;           //per sample
+        const float* wet;           //per sample
+        DelayInterpolation::Mode interpolation;
+        DelayInterpolation::TapPositions taps;
+        int bitDepth;
+        int rateDivide;
+        const float* decimated{ nullptr };  //per sample, already decimated input (Decimator, DecimationFilter),
+                                            //or nullptr to quantize and hold in the loop
+    };
+
+    //Processes numSamples of channelData in place, reading and writing channel of
+    //delayLine from writePosition on. Returns the peak level written into the line.
+    //decimatorState is left alone when the decimated input is given.
+    //Instantiated for float and double channelData, the line stays float either way.
+    template <typename SampleType>
+    float process(DelayLine& delayLine, int channel, int writePosition, SampleType* channelData, int numSamples,
+                  const Parameters& parameters, Decimator::ChannelState& decimatorState, float& allpassState);
+}
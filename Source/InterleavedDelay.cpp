@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    InterleavedDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "InterleavedDelay.h"
+#include "Decimator.h"
+#include "DelayEnergyTracker.h"
+
+void InterleavedDelay::prepare(int numChannels, int delayBufferLength, int maxBlockSize, int maxRateDivide)
+{
+    mNumChannels = numChannels;
+    mNumGroups = (numChannels + numLanes - 1) / numLanes;
+    mMaxBlockSize = maxBlockSize;
+
+    mDelayLine.prepare(mNumGroups, delayBufferLength, maxBlockSize, numLanes);
+    mHeldLanes.assign((size_t)mNumGroups * numLanes, 0.0f);
+    mAllpassStates.assign((size_t)mNumGroups * numLanes, 0.0f);
+    mInput.assign((size_t)maxBlockSize * numLanes, 0.0f);
+    mWet.assign((size_t)maxBlockSize * numLanes, 0.0f);
+    mTaps.assign((size_t)maxBlockSize * numLanes, 0.0f);
+    mDecimationFilter.prepare(mNumGroups, numLanes, maxRateDivide, maxBlockSize);
+    reset();
+}
+
+void InterleavedDelay::reset()
+{
+    mDelayLine.clear();
+    std::fill(mHeldLanes.begin(), mHeldLanes.end(), 0.0f);
+    mHoldCounter = 0;
+    mDecimationFilter.reset();
+    resetInterpolation();
+}
+
+void InterleavedDelay::resetInterpolation()
+{
+    std::fill(mAllpassStates.begin(), mAllpassStates.end(), 0.0f);
+}
+
+void InterleavedDelay::setDecimation(int bitDepth, int rateDivide, DecimationFilter::Mode mode)
+{
+    bitDepth = juce::jlimit(Decimator::minBitDepth, Decimator::maxBitDepth, bitDepth);
+    mBitDepth = bitDepth;
+    mQLevels = std::ldexp(1.0f, bitDepth);
+    mInvQLevels = 1.0f / mQLevels;
+    mRateDivide = juce::jmax(1, rateDivide);
+
+    //A clean mode that was just switched on starts its filters from silence
+    if (mode != mDecimationMode && mode != DecimationFilter::Mode::hold)
+        mDecimationFilter.reset();
+
+    mDecimationMode = mode;
+}
+
+void InterleavedDelay::skip(int numSamples)
+{
+    if (mHoldCounter >= mRateDivide)
+        mHoldCounter = 0;
+
+    mHoldCounter = (mHoldCounter + numSamples) % mRateDivide;
+}
+
+template <typename SampleType>
+float InterleavedDelay::process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                               int writePosition, const BlockParameters& parameters)
+{
+    jassert(numSamples <= mMaxBlockSize);
+
+    //A run left over from a longer hold ends as soon as the rate goes up
+    if (mHoldCounter >= mRateDivide)
+        mHoldCounter = 0;
+
+    const int numFloats = numSamples * numLanes;
+    auto* input = mInput.data();
+    auto* wet = mWet.data();
+    auto* taps = mTaps.data();
+    float peak = 0.0f;
+
+    for (int group = 0; group < mNumGroups; ++group)
+    {
+        const int firstChannel = group * numLanes;
+        const int numGroupChannels = juce::jmin(numLanes, mNumChannels - firstChannel);
+
+        //Pack the group's channels into lanes, unused lanes stay silent
+        if (numGroupChannels < numLanes)
+            juce::FloatVectorOperations::clear(input, numFloats);
+
+        for (int lane = 0; lane < numGroupChannels; ++lane)
+        {
+            auto* channelData = buffer.getReadPointer(firstChannel + lane, startSample);
+
+            for (int i = 0; i < numSamples; ++i)
+                input[i * numLanes + lane] = (float)channelData[i];
+        }
+
+        //Delayed signal scaled by the feedback gain
+        DelayInterpolation::read<numLanes>(parameters.interpolation, mDelayLine, group, parameters.taps,
+                                           taps, numSamples, mAllpassStates.data() + group * numLanes);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float feedback = parameters.feedback[i];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                wet[i * numLanes + lane] = taps[i * numLanes + lane] * feedback;
+        }
+
+        decimate(group, input, mHeldLanes.data() + group * numLanes, numSamples, mHoldCounter);
+
+        //Decimated input plus feedback is what gets written back, the wet output is the feedback alone
+        juce::FloatVectorOperations::add(wet, input, numFloats);
+        mDelayLine.write(group, writePosition, wet, numSamples);
+        peak = juce::jmax(peak, DelayEnergyTracker::getPeak(wet, numFloats));
+        juce::FloatVectorOperations::subtract(wet, input, numFloats);
+
+        //Unpack with the dry/wet gains applied
+        for (int lane = 0; lane < numGroupChannels; ++lane)
+        {
+            auto* channelData = buffer.getWritePointer(firstChannel + lane, startSample);
+
+            for (int i = 0; i < numSamples; ++i)
+                channelData[i] = channelData[i] * (SampleType)parameters.dry[i] + (SampleType)(wet[i * numLanes + lane] * parameters.wet[i]);
+        }
+    }
+
+    mHoldCounter = (mHoldCounter + numSamples) % mRateDivide;
+    return peak;
+}
+
+template float InterleavedDelay::process(juce::AudioBuffer<float>&, int, int, int, const BlockParameters&);
+template float InterleavedDelay::process(juce::AudioBuffer<double>&, int, int, int, const BlockParameters&);
+
+void InterleavedDelay::readChannel(int channel, int position, float* dest, int numFrames) const
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels) && numFrames <= mMaxBlockSize);
+
+    const int lane = channel % numLanes;
+    const float* frames = mDelayLine.getReadPointer(channel / numLanes, position);
+
+    for (int i = 0; i < numFrames; ++i)
+        dest[i] = frames[i * numLanes + lane];
+}
+
+//All lanes share one hold phase, so a hold run is a single vector quantize
+//followed by copying that frame across the run
+void InterleavedDelay::decimate(int group, float* frames, float* heldLanes, int numSamples, int holdCounter)
+{
+    if (mDecimationMode != DecimationFilter::Mode::hold)
+    {
+        mDecimationFilter.process<numLanes>(mDecimationMode, group, frames, numSamples, heldLanes, holdCounter,
+                                            mBitDepth, mRateDivide);
+        return;
+    }
+
+    if (mRateDivide <= 1)
+    {
+        Decimator::quantize(frames, numSamples * numLanes, mQLevels, mInvQLevels);
+        return;
+    }
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        if (holdCounter == 0)
+        {
+            std::copy(frames + i * numLanes, frames + (i + 1) * numLanes, heldLanes);
+            Decimator::quantize(heldLanes, numLanes, mQLevels, mInvQLevels);
+        }
+
+        const int runLength = juce::jmin(mRateDivide - holdCounter, numSamples - i);
+
+        for (int j = i; j < i + runLength; ++j)
+            std::copy(heldLanes, heldLanes + numLanes, frames + j * numLanes);
+
+        holdCounter = (holdCounter + runLength) % mRateDivide;
+        i += runLength;
+    }
+}
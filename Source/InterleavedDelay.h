@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    InterleavedDelay.h
+
+    Delay engine for wide buses. Channels are packed in groups of numLanes
+    and the delay line is stored frame by frame (a DelayLine with one channel
+    per group and numLanes lanes per frame), so
+    every step of the fill/decimate/read pipeline is one contiguous pass
+    that handles numLanes channels per SIMD operation, instead of one walk
+    over the delay line per channel.
+
+    Produces the same output as the per-channel path in
+    BitDelayAudioProcessor::processChunk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DecimationFilter.h"
+#include "DelayInterpolation.h"
+#include "DelayLine.h"
+#include <vector>
+
+class InterleavedDelay
+{
+public:
+#if defined(__AVX__)
+    static constexpr int numLanes = 8;
+#else
+    static constexpr int numLanes = 4;
+#endif
+
+    //Per-sample parameter values for one block
+    struct BlockParameters
+    {
+        const float* feedback;
+        const float* dry;
+        const float* wet;
+        DelayInterpolation::Mode interpolation;
+        DelayInterpolation::TapPositions taps;
+    };
+
+    //delayBufferLength is the minimum length, the DelayLine rounds it up to a power of two.
+    //maxRateDivide is the largest rate divide the clean decimation modes have to handle.
+    void prepare(int numChannels, int delayBufferLength, int maxBlockSize, int maxRateDivide = 1);
+    void reset();
+
+    //Clears the allpass interpolation state, for when the interpolation mode changes
+    void resetInterpolation();
+
+    //Same meaning as Decimator::setParameters, mode picks plain or band-limited hold
+    void setDecimation(int bitDepth, int rateDivide, DecimationFilter::Mode mode = DecimationFilter::Mode::hold);
+
+    //Moves the hold phase on by numSamples, like Decimator::skip
+    void skip(int numSamples);
+
+    //Processes numSamples of buffer in place, starting at startSample.
+    //numSamples must not exceed the maxBlockSize given to prepare(), and the
+    //taps must not reach into the block itself (the delay has to be longer).
+    //Returns the peak level written into the delay line. Instantiated for float
+    //and double buffers, which are packed into (and unpacked from) float lanes.
+    template <typename SampleType>
+    float process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                 int writePosition, const BlockParameters& parameters);
+
+    //The packed line, numLanes channels per frame, for reads outside process()
+    const DelayLine& getDelayLine() const { return mDelayLine; }
+
+    //Copies numFrames frames of one channel's delay line, starting at position (wrapped)
+    void readChannel(int channel, int position, float* dest, int numFrames) const;
+
+private:
+    void decimate(int group, float* frames, float* heldLanes, int numSamples, int holdCounter);
+
+    int mNumChannels{ 0 };
+    int mNumGroups{ 0 };
+    int mMaxBlockSize{ 0 };
+
+    DelayLine mDelayLine;            //one channel per group
+    std::vector<float> mHeldLanes;   //[group][lane]
+    std::vector<float> mAllpassStates;   //[group][lane]
+    std::vector<float> mInput;       //[sample][lane] scratch for one group
+    std::vector<float> mWet;         //[sample][lane] scratch for one group
+    std::vector<float> mTaps;        //[sample][lane] scratch for one group
+    DecimationFilter mDecimationFilter;  //one channel per group
+
+    int mHoldCounter{ 0 };
+    int mRateDivide{ 1 };
+    int mBitDepth{ 8 };
+    DecimationFilter::Mode mDecimationMode{ DecimationFilter::Mode::hold };
+    float mQLevels{ 256.0f };
+    float mInvQLevels{ 1.0f / 256.0f };
+};
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    MultiTap.cpp
+
+  ==============================================================================
+*/
+
+#include "MultiTap.h"
+
+void MultiTap::getPanGains(const Settings& settings, bool stereo, float& left, float& right)
+{
+    const float pan = juce::jlimit(-1.0f, 1.0f, settings.pan);
+    left = stereo ? settings.level * juce::jmin(1.0f, 1.0f - pan) : settings.level;
+    right = stereo ? settings.level * juce::jmin(1.0f, 1.0f + pan) : settings.level;
+}
+
+void MultiTap::prepare(int numChannels, int numLanes, bool stereo, int maxBlockSize, double sampleRate,
+                       double timeRampSeconds, double gainRampSeconds, const TapSettings& settings)
+{
+    mNumChannels = numChannels;
+    mStereo = stereo;
+    mMaxBlockSize = maxBlockSize;
+
+    mValues.setSize(maxTaps * numValues, maxBlockSize);
+    mValues.clear();
+    mIndices.assign((size_t)(maxTaps * maxBlockSize), 0);
+    mFractions.assign((size_t)(maxTaps * maxBlockSize), 0.0f);
+    mAllpassStates.assign((size_t)(maxTaps * numChannels), 0.0f);
+    mTapBuffer.assign((size_t)(maxBlockSize * numLanes), 0.0f);
+
+    for (int tap = 0; tap < maxTaps; ++tap)
+    {
+        float left, right;
+        getPanGains(settings[(size_t)tap], stereo, left, right);
+        mTimeSmoothers[(size_t)tap].reset(sampleRate, timeRampSeconds, settings[(size_t)tap].time);
+        mLeftSmoothers[(size_t)tap].reset(sampleRate, gainRampSeconds, left);
+        mRightSmoothers[(size_t)tap].reset(sampleRate, gainRampSeconds, right);
+    }
+
+    mIsActive.fill(false);
+    mNumActive = 0;
+    setTargets(settings);
+}
+
+void MultiTap::setTargets(const TapSettings& settings)
+{
+    mNumActive = 0;
+
+    for (int tap = 0; tap < maxTaps; ++tap)
+    {
+        auto& timeSmoother = mTimeSmoothers[(size_t)tap];
+        auto& leftSmoother = mLeftSmoothers[(size_t)tap];
+        auto& rightSmoother = mRightSmoothers[(size_t)tap];
+
+        float left, right;
+        getPanGains(settings[(size_t)tap], mStereo, left, right);
+        timeSmoother.setTargetValue(settings[(size_t)tap].time);
+        leftSmoother.setTargetValue(left);
+        rightSmoother.setTargetValue(right);
+
+        const bool active = left != 0.0f || right != 0.0f
+                            || leftSmoother.getCurrentValue() != 0.0f || rightSmoother.getCurrentValue() != 0.0f;
+
+        if (! active)
+        {
+            timeSmoother.snapToTarget();
+            leftSmoother.snapToTarget();
+            rightSmoother.snapToTarget();
+        }
+        else if (! mIsActive[(size_t)tap])
+        {
+            std::fill(mAllpassStates.begin() + tap * mNumChannels, mAllpassStates.begin() + (tap + 1) * mNumChannels, 0.0f);
+        }
+
+        mIsActive[(size_t)tap] = active;
+
+        if (active)
+            mActive[(size_t)mNumActive++] = tap;
+    }
+}
+
+void MultiTap::snapToTargets()
+{
+    for (int tap = 0; tap < maxTaps; ++tap)
+    {
+        mTimeSmoothers[(size_t)tap].snapToTarget();
+        mLeftSmoothers[(size_t)tap].snapToTarget();
+        mRightSmoothers[(size_t)tap].snapToTarget();
+    }
+}
+
+void MultiTap::update(DelayInterpolation::Mode mode, int writePosition, double samplesPerKnobUnit, int lengthMask, int numSamples)
+{
+    jassert(numSamples <= mMaxBlockSize);
+
+    //A switched interpolation mode starts the allpasses from rest, like the main tap
+    if (mode != mInterpolation)
+    {
+        mInterpolation = mode;
+        std::fill(mAllpassStates.begin(), mAllpassStates.end(), 0.0f);
+    }
+
+    for (int index = 0; index < mNumActive; ++index)
+    {
+        const int tap = mActive[(size_t)index];
+        auto& timeSmoother = mTimeSmoothers[(size_t)tap];
+        auto& positions = mPositions[(size_t)tap];
+        auto* times = mValues.getWritePointer(tap * numValues + timeIndex);
+
+        mLeftSmoothers[(size_t)tap].process(mValues.getWritePointer(tap * numValues + leftIndex), numSamples);
+        mRightSmoothers[(size_t)tap].process(mValues.getWritePointer(tap * numValues + rightIndex), numSamples);
+
+        if (! timeSmoother.isSmoothing())
+        {
+            timeSmoother.process(times, numSamples);
+            positions = {};
+            DelayInterpolation::getTapPosition(mode, writePosition, samplesPerKnobUnit * timeSmoother.getTargetValue(),
+                                               lengthMask, positions.startIndex, positions.fraction);
+            continue;
+        }
+
+        auto* indices = mIndices.data() + tap * mMaxBlockSize;
+        auto* fractions = mFractions.data() + tap * mMaxBlockSize;
+        timeSmoother.process(times, numSamples);
+        DelayInterpolation::fillTapPositions(mode, writePosition, times, samplesPerKnobUnit, lengthMask, indices, fractions, numSamples);
+        positions = { indices, fractions, 0, 0.0f };
+    }
+}
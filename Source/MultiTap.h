@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    MultiTap.h
+
+    Up to maxTaps extra read taps on the processor's delay line, each with
+    its own time, level and pan, for rhythmic multi-echo patterns without
+    stacking instances. The taps only feed the output: the line keeps one
+    write (decimated input plus the main tap's feedback), and the taps are
+    read after the engine has written the span, so a tap shorter than the
+    span still hears the frames written just before it.
+
+    Times are in Time knob units and go through the same scale as the main
+    tap. Level and pan are ramped like the main gains; pan uses a balance
+    law (centre leaves both sides at the tap's level) and only applies to
+    stereo, every other layout gets the level on all channels.
+
+    A tap whose level is 0 and not ramping costs nothing. Which taps are on
+    is decided once per chunk, when the targets are set.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayInterpolation.h"
+#include "ParameterSmoother.h"
+#include <array>
+#include <vector>
+
+class MultiTap
+{
+public:
+    static constexpr int maxTaps = 8;
+
+    struct Settings
+    {
+        float time{ 0.0f };     //Time knob units
+        float level{ 0.0f };
+        float pan{ 0.0f };      //-1 left .. 1 right
+    };
+
+    using TapSettings = std::array<Settings, maxTaps>;
+
+    //Left and right gain of a tap, the ramp targets
+    static void getPanGains(const Settings& settings, bool stereo, float& left, float& right);
+
+    //numChannels is the number of allpass states kept per tap, a whole number of
+    //numLanes for the interleaved engine (numLanes is 1 otherwise). The ramps take
+    //the processor's smoothing times. Jumps to settings without ramping.
+    void prepare(int numChannels, int numLanes, bool stereo, int maxBlockSize, double sampleRate,
+                 double timeRampSeconds, double gainRampSeconds, const TapSettings& settings);
+
+    //Once per chunk: new targets, and which taps are on for the chunk. A tap that
+    //comes on starts its allpass from rest, one that is off jumps to its time.
+    void setTargets(const TapSettings& settings);
+
+    //For chunks that are skipped while the processor sleeps
+    void snapToTargets();
+
+    bool isActive() const { return mNumActive > 0; }
+
+    //Ramps the active taps over the span and works out where they read
+    void update(DelayInterpolation::Mode mode, int writePosition, double samplesPerKnobUnit, int lengthMask, int numSamples);
+
+    //Sums the active taps of Lanes interleaved channels starting at firstChannel into
+    //sum (numSamples frames of Lanes values). readTaps(taps, dest, allpassState) reads
+    //one tap's frames from the delay storage.
+    template <int Lanes, typename ReadTaps>
+    void gather(int firstChannel, ReadTaps&& readTaps, float* sum, int numSamples)
+    {
+        juce::FloatVectorOperations::clear(sum, numSamples * Lanes);
+        auto* taps = mTapBuffer.data();
+
+        for (int index = 0; index < mNumActive; ++index)
+        {
+            const int tap = mActive[(size_t)index];
+            readTaps(mPositions[(size_t)tap], taps, &mAllpassStates[(size_t)(tap * mNumChannels + firstChannel)]);
+
+            if (Lanes == 1)
+            {
+                juce::FloatVectorOperations::addWithMultiply(sum, taps, getGains(tap, firstChannel), numSamples);
+                continue;
+            }
+
+            //Without pan every lane has the same gain
+            if (! mStereo)
+            {
+                const float* gain = getGains(tap, firstChannel);
+
+                for (int i = 0; i < numSamples; ++i)
+                    for (int lane = 0; lane < Lanes; ++lane)
+                        sum[i * Lanes + lane] += taps[i * Lanes + lane] * gain[i];
+
+                continue;
+            }
+
+            const float* gains[Lanes];
+
+            for (int lane = 0; lane < Lanes; ++lane)
+                gains[lane] = getGains(tap, firstChannel + lane);
+
+            for (int i = 0; i < numSamples; ++i)
+                for (int lane = 0; lane < Lanes; ++lane)
+                    sum[i * Lanes + lane] += taps[i * Lanes + lane] * gains[lane][i];
+        }
+    }
+
+private:
+    enum ValueIndex { timeIndex, leftIndex, rightIndex, numValues };
+
+    const float* getGains(int tap, int channel) const
+    {
+        return mValues.getReadPointer(tap * numValues + (mStereo && channel == 1 ? rightIndex : leftIndex));
+    }
+
+    int mNumChannels{ 0 };
+    bool mStereo{ false };
+    int mMaxBlockSize{ 0 };
+    DelayInterpolation::Mode mInterpolation{ DelayInterpolation::Mode::linear };
+
+    std::array<ParameterSmoother, maxTaps> mTimeSmoothers;
+    std::array<ParameterSmoother, maxTaps> mLeftSmoothers;
+    std::array<ParameterSmoother, maxTaps> mRightSmoothers;
+    std::array<bool, maxTaps> mIsActive{};
+    std::array<int, maxTaps> mActive{};
+    int mNumActive{ 0 };
+
+    //Per tap: smoothed time, left and right gain for the span
+    juce::AudioBuffer<float> mValues;
+    std::array<DelayInterpolation::TapPositions, maxTaps> mPositions;
+    std::vector<int> mIndices;
+    std::vector<float> mFractions;
+    std::vector<float> mAllpassStates;
+    std::vector<float> mTapBuffer;
+};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSmoother.h"
+
+void ParameterSmoother::reset(double sampleRate, double rampSeconds, float initialValue)
+{
+    mRampLength = juce::jmax(0, (int)std::floor(rampSeconds * sampleRate));
+    mCurrent = mTarget = initialValue;
+    mStep = 0.0f;
+    mStepsRemaining = 0;
+}
+
+void ParameterSmoother::snapToTarget()
+{
+    mCurrent = mTarget;
+    mStepsRemaining = 0;
+}
+
+void ParameterSmoother::setTargetValue(float newTarget)
+{
+    if (newTarget == mTarget)
+        return;
+
+    mTarget = newTarget;
+
+    if (mRampLength <= 0)
+    {
+        snapToTarget();
+        return;
+    }
+
+    mRampStart = mCurrent;
+    mStepsRemaining = mRampLength;
+    mStep = (mTarget - mCurrent) / (float)mStepsRemaining;
+}
+
+void ParameterSmoother::process(float* dest, int numSamples)
+{
+    const int numRamped = juce::jmin(numSamples, mStepsRemaining);
+    const int stepsDone = mRampLength - mStepsRemaining;
+
+    for (int i = 0; i < numRamped; ++i)
+        dest[i] = mRampStart + mStep * (float)(stepsDone + i + 1);
+
+    mStepsRemaining -= numRamped;
+    mCurrent = mStepsRemaining > 0 ? mRampStart + mStep * (float)(stepsDone + numRamped) : mTarget;
+
+    juce::FloatVectorOperations::fill(dest + numRamped, mTarget, numSamples - numRamped);
+}
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    ParameterSmoother.h
+
+    Linear per-sample smoothing for parameters read on the audio thread.
+    The target is set once per block and process() writes the ramp for the
+    whole block into an array. Every value of the ramp is computed directly
+    from its index since the ramp started, so the loop has no carried
+    dependency and vectorizes, and the values come out the same however
+    the ramp is split into blocks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ParameterSmoother
+{
+public:
+    //Jumps straight to initialValue, ramps afterwards take rampSeconds
+    void reset(double sampleRate, double rampSeconds, float initialValue);
+
+    //Jumps to the current target without ramping
+    void snapToTarget();
+
+    void setTargetValue(float newTarget);
+
+    float getCurrentValue() const   { return mCurrent; }
+    float getTargetValue() const    { return mTarget; }
+    bool isSmoothing() const        { return mStepsRemaining > 0; }
+
+    //Writes the next numSamples values into dest and advances by that much
+    void process(float* dest, int numSamples);
+
+private:
+    float mCurrent{ 0.0f };
+    float mTarget{ 0.0f };
+    float mRampStart{ 0.0f };
+    float mStep{ 0.0f };
+    int mStepsRemaining{ 0 };
+    int mRampLength{ 0 };
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    ParameterState.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterState.h"
+#include "PluginProcessor.h"
+
+namespace ParameterState
+{
+    namespace
+    {
+        constexpr juce::uint32 magic = 0x74734442;     //"BDst" in little endian
+        constexpr int headerSize = 12;
+        constexpr int entrySize = 8;
+
+        void writeShort(char* dest, int value)
+        {
+            const auto v = juce::ByteOrder::swapIfBigEndian((juce::uint16)value);
+            std::memcpy(dest, &v, sizeof(v));
+        }
+
+        void writeInt(char* dest, juce::uint32 value)
+        {
+            const auto v = juce::ByteOrder::swapIfBigEndian(value);
+            std::memcpy(dest, &v, sizeof(v));
+        }
+
+        float readFloat(const char* source)
+        {
+            const juce::uint32 bits = juce::ByteOrder::littleEndianInt(source);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+
+    juce::uint32 getParameterId(const juce::String& name)
+    {
+        juce::uint32 hash = 2166136261u;
+
+        for (auto* c = name.toRawUTF8(); *c != 0; ++c)
+        {
+            hash ^= (juce::uint8)*c;
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    void write(const juce::AudioProcessor& processor, juce::MemoryBlock& destData)
+    {
+        const auto& parameters = processor.getParameters();
+        const int numEntries = (int)parameters.size();
+
+        destData.setSize((size_t)(headerSize + numEntries * entrySize));
+        auto* data = static_cast<char*>(destData.getData());
+
+        writeInt(data, magic);
+        writeShort(data + 4, version);
+        writeShort(data + 6, headerSize);
+        writeShort(data + 8, numEntries);
+        writeShort(data + 10, entrySize);
+
+        for (int i = 0; i < numEntries; ++i)
+        {
+            const auto* parameter = static_cast<const Echo_Parameter*>(parameters[i]);
+            auto* entry = data + headerSize + i * entrySize;
+            const float value = parameter->get();
+            juce::uint32 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+
+            writeInt(entry, parameter->stateId);
+            writeInt(entry + 4, bits);
+        }
+    }
+
+    bool read(juce::AudioProcessor& processor, const void* data, int sizeInBytes)
+    {
+        auto* bytes = static_cast<const char*>(data);
+
+        if (bytes == nullptr || sizeInBytes < headerSize || juce::ByteOrder::littleEndianInt(bytes) != magic)
+            return false;
+
+        //Newer versions only ever add to the header and the entries
+        const int stateHeaderSize = juce::ByteOrder::littleEndianShort(bytes + 6);
+        const int numEntries = juce::ByteOrder::littleEndianShort(bytes + 8);
+        const int stateEntrySize = juce::ByteOrder::littleEndianShort(bytes + 10);
+
+        if (stateHeaderSize < headerSize || stateEntrySize < entrySize
+            || (juce::int64)stateHeaderSize + (juce::int64)numEntries * stateEntrySize > sizeInBytes)
+            return false;
+
+        const auto& parameters = processor.getParameters();
+
+        for (int i = 0; i < numEntries; ++i)
+        {
+            auto* entry = bytes + stateHeaderSize + i * stateEntrySize;
+            const juce::uint32 id = juce::ByteOrder::littleEndianInt(entry);
+            const float value = readFloat(entry + 4);
+
+            if (! std::isfinite(value))
+                continue;
+
+            for (auto* p : parameters)
+            {
+                auto* parameter = static_cast<Echo_Parameter*>(p);
+
+                if (parameter->stateId == id)
+                {
+                    parameter->setRealValueNotifyingHost(juce::jlimit(parameter->range.start, parameter->range.end, value));
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    ParameterState.h
+
+    Binary plugin state: every Echo_Parameter's real value, keyed by a hash
+    of its name. All fields are little endian:
+
+        offset  size
+        0       4       magic "BDst"
+        4       2       format version (currently 1)
+        6       2       header size in bytes (12)
+        8       2       number of entries
+        10      2       entry size in bytes (8)
+        12      ...     entries: uint32 parameter id, float32 real value
+
+    Later versions may grow the header or the entries, readers skip what
+    they don't know through the two size fields. Entries are matched by
+    id, so parameters can be added, removed or reordered: unknown ids are
+    ignored and parameters missing from the state keep their value.
+    Values are stored in real units, so a parameter's range can change
+    between versions and old values are clamped onto the new range.
+
+    read() does no allocation, so restoring hundreds of instances costs
+    little more than copying the values in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace ParameterState
+{
+    static constexpr int version = 1;
+
+    //Stable id for a parameter name (32-bit FNV-1a of its UTF-8 bytes)
+    juce::uint32 getParameterId(const juce::String& name);
+
+    //Replaces destData with the state of every Echo_Parameter of processor
+    void write(const juce::AudioProcessor& processor, juce::MemoryBlock& destData);
+
+    //Restores what data holds onto processor's parameters. Returns false, and
+    //changes nothing, when data isn't a state in this format.
+    bool read(juce::AudioProcessor& processor, const void* data, int sizeInBytes);
+}
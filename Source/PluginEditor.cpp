@@ -12,11 +12,12 @@
 
 //==============================================================================
 BitDelayAudioProcessorEditor::BitDelayAudioProcessorEditor(BitDelayAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), scope(p.getScopeFifo())
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    timeSlider.setRange(0.0f, 1.7f);
+    auto* timeParameter = audioProcessor.getMainParameter(BitDelayAudioProcessor::mainTime);
+    timeSlider.setRange(timeParameter->range.start, timeParameter->range.end);
     
     timeLabel.setText("Echo Time", juce::dontSendNotification);
     
@@ -43,6 +44,13 @@ BitDelayAudioProcessorEditor::BitDelayAudioProcessorEditor(BitDelayAudioProcesso
 
     regenSlider.addListener(this);
 
+    bitDepthSlider.setSliderStyle(juce::Slider::Rotary);
+    bitDepthSlider.setRange(4.0f, 16.0f, 1.0f);
+    bitDepthSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    bitDepthLabel.setText("Bit Depth", juce::dontSendNotification);
+
+    bitDepthSlider.addListener(this);
+
     dryLabel.setText("Dry Volume", juce::dontSendNotification);
     drySlider.setRange(0.0f, 0.7f);
     drySlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
@@ -54,26 +62,112 @@ BitDelayAudioProcessorEditor::BitDelayAudioProcessorEditor(BitDelayAudioProcesso
     drySlider.addListener(this);
     wetSlider.addListener(this);
 
+    auto* maxTimeParameter = audioProcessor.getMainParameter(BitDelayAudioProcessor::mainMaxTime);
+    maxTimeLabel.setText("Max Time", juce::dontSendNotification);
+    maxTimeSlider.setRange(maxTimeParameter->range.start, maxTimeParameter->range.end);
+    maxTimeSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    maxTimeSlider.addListener(this);
+
+    //Item ids are the parameter's steps plus one, since ComboBox reserves id 0
+    auto* interpolationParameter = audioProcessor.getMainParameter(BitDelayAudioProcessor::mainInterpolation);
+    interpolationLabel.setText("Interpolation", juce::dontSendNotification);
+    interpolationBox.addItemList(interpolationParameter->valueNames, 1);
+    interpolationBox.onChange = [this, interpolationParameter]
+    {
+        interpolationParameter->beginChangeGesture();
+        interpolationParameter->setRealValueNotifyingHost((float)(interpolationBox.getSelectedId() - 1));
+        interpolationParameter->endChangeGesture();
+    };
+
+    auto* decimationParameter = audioProcessor.getMainParameter(BitDelayAudioProcessor::mainDecimation);
+    decimationLabel.setText("Decimation", juce::dontSendNotification);
+    decimationBox.addItemList(decimationParameter->valueNames, 1);
+    decimationBox.onChange = [this, decimationParameter]
+    {
+        decimationParameter->beginChangeGesture();
+        decimationParameter->setRealValueNotifyingHost((float)(decimationBox.getSelectedId() - 1));
+        decimationParameter->endChangeGesture();
+    };
+
+    tapLabel.setText("Tap", juce::dontSendNotification);
+
+    for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+        tapBox.addItem(juce::String(tap + 1), tap + 1);
+
+    tapBox.onChange = [this]
+    {
+        mSelectedTap = tapBox.getSelectedId() - 1;
+        retrieveParameterValues();
+    };
+
+    tapTimeLabel.setText("Tap Time", juce::dontSendNotification);
+    tapLevelLabel.setText("Tap Level", juce::dontSendNotification);
+    tapPanLabel.setText("Pan", juce::dontSendNotification);
+
+    for (auto* slider : { &tapTimeSlider, &tapLevelSlider, &tapPanSlider })
+    {
+        slider->setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+        slider->addListener(this);
+    }
+
+    tapTimeSlider.setRange(timeParameter->range.start, timeParameter->range.end);
+    tapLevelSlider.setRange(0.0f, 0.7f);
+    tapPanSlider.setRange(-1.0f, 1.0f);
+
     addAndMakeVisible(timeSlider);
     addAndMakeVisible(timeLabel);
     //addAndMakeVisible(echoVolSlider);
     //addAndMakeVisible(echoVolLabel);
     addAndMakeVisible(regenSlider);
     addAndMakeVisible(regenLabel);
+    addAndMakeVisible(bitDepthSlider);
+    addAndMakeVisible(bitDepthLabel);
     addAndMakeVisible(drySlider);
     addAndMakeVisible(wetSlider);
     addAndMakeVisible(dryLabel);
     addAndMakeVisible(wetLabel);
+    addAndMakeVisible(maxTimeLabel);
+    addAndMakeVisible(maxTimeSlider);
+    addAndMakeVisible(interpolationLabel);
+    addAndMakeVisible(interpolationBox);
+    addAndMakeVisible(decimationLabel);
+    addAndMakeVisible(decimationBox);
+    addAndMakeVisible(tapLabel);
+    addAndMakeVisible(tapBox);
+    addAndMakeVisible(tapTimeLabel);
+    addAndMakeVisible(tapTimeSlider);
+    addAndMakeVisible(tapLevelLabel);
+    addAndMakeVisible(tapLevelSlider);
+    addAndMakeVisible(tapPanLabel);
+    addAndMakeVisible(tapPanSlider);
+    addAndMakeVisible(scope);
+
+    captureButton.onClick = [this] { toggleCapture(); };
+    captureLabel.setFont(juce::FontOptions(12.0f));
+    addAndMakeVisible(captureButton);
+    addAndMakeVisible(captureLabel);
 
+    if (DspStats::enabled)
+    {
+        statsLabel.setFont(juce::FontOptions(12.0f));
+        statsLabel.addMouseListener(this, false);
+        addAndMakeVisible(statsLabel);
+    }
+
+    updateCaptureStatus();
+    startTimerHz(4);
+
+    tapBox.setSelectedId(1, juce::dontSendNotification);
     retrieveParameterValues();
 
     setLookAndFeel(&newLookAndFeel);
 
-    setSize(400, 300);
+    setSize(400, DspStats::enabled ? 487 : 467);
 }
 
 BitDelayAudioProcessorEditor::~BitDelayAudioProcessorEditor()
 {
+    stopTimer();
     setLookAndFeel(nullptr);
 }
 
@@ -90,7 +184,7 @@ void BitDelayAudioProcessorEditor::resized()
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
 
-    int x_offset = 40;
+    int x_offset = 0; //three knobs fill the row
 
     timeLabel.setBounds(20+x_offset, 60, 120, 20);
     timeLabel.setJustificationType(juce::Justification::centred);
@@ -99,6 +193,9 @@ void BitDelayAudioProcessorEditor::resized()
     echoVolLabel.setJustificationType(juce::Justification::centred);
     //echoVolSlider.setBounds(100, 40, getWidth() - 110, 20);
     echoVolSlider.setBounds(140, 100, 120, 120);
+    bitDepthLabel.setBounds(140, 60, 120, 20);
+    bitDepthLabel.setJustificationType(juce::Justification::centred);
+    bitDepthSlider.setBounds(140, 100, 120, 120);
     regenLabel.setBounds(260-x_offset, 60, 120, 20);
     regenLabel.setJustificationType(juce::Justification::centred);
     //regenSlider.setBounds(100, 70, getWidth() - 110, 20);
@@ -108,29 +205,172 @@ void BitDelayAudioProcessorEditor::resized()
     wetLabel.setBounds(40, 265, 80, 20);
     drySlider.setBounds(120, 245, 250, 20);
     wetSlider.setBounds(120, 265, 250, 20);
+
+    maxTimeLabel.setBounds(40, 38, 80, 20);
+    maxTimeSlider.setBounds(120, 38, 250, 20);
+
+    interpolationLabel.setBounds(150, 15, 100, 20);
+    interpolationBox.setBounds(250, 15, 120, 20);
+
+    decimationLabel.setBounds(10, 15, 70, 20);
+    decimationBox.setBounds(80, 15, 65, 20);
+
+    tapLabel.setBounds(40, 290, 40, 20);
+    tapBox.setBounds(80, 290, 60, 20);
+    tapPanLabel.setBounds(150, 290, 40, 20);
+    tapPanSlider.setBounds(190, 290, 180, 20);
+    tapTimeLabel.setBounds(40, 310, 80, 20);
+    tapTimeSlider.setBounds(120, 310, 250, 20);
+    tapLevelLabel.setBounds(40, 330, 80, 20);
+    tapLevelSlider.setBounds(120, 330, 250, 20);
+
+    scope.setBounds(20, 360, 360, 70);
+    captureButton.setBounds(20, 437, 70, 20);
+    captureLabel.setBounds(95, 437, 285, 20);
+    statsLabel.setBounds(20, 459, 360, 20);
+}
+
+void BitDelayAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+{
+    if (event.eventComponent == &statsLabel)
+    {
+        audioProcessor.getDspStats().requestReset();
+        mLastStats = {};
+    }
+}
+
+void BitDelayAudioProcessorEditor::toggleCapture()
+{
+    auto& capture = audioProcessor.getDelayCapture();
+
+    if (capture.isCapturing())
+    {
+        capture.stop();
+        updateCaptureStatus();
+        return;
+    }
+
+    mCaptureChooser = std::make_unique<juce::FileChooser>("Capture the wet signal to", juce::File(), "*.wav;*.flac");
+    mCaptureChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                     | juce::FileBrowserComponent::warnAboutOverwriting,
+                                 [this](const juce::FileChooser& chooser)
+    {
+        auto wetFile = chooser.getResult();
+
+        if (wetFile == juce::File())
+            return;
+
+        if (! wetFile.hasFileExtension("wav;flac"))
+            wetFile = wetFile.withFileExtension("wav");
+
+        const auto lineFile = wetFile.getSiblingFile(wetFile.getFileNameWithoutExtension() + " line" + wetFile.getFileExtension());
+        const auto result = audioProcessor.getDelayCapture().start(wetFile, lineFile);
+
+        if (result.failed())
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Capture", result.getErrorMessage());
+
+        updateCaptureStatus();
+    });
+}
+
+void BitDelayAudioProcessorEditor::updateCaptureStatus()
+{
+    const auto& capture = audioProcessor.getDelayCapture();
+    const auto sampleRate = juce::jmax(1.0, audioProcessor.getSampleRate());
+    const auto written = capture.getWrittenFrames();
+    const auto dropped = capture.getDroppedFrames();
+
+    captureButton.setButtonText(capture.isCapturing() ? "Stop" : "Capture");
+
+    juce::String status;
+
+    if (capture.isCapturing() || written > 0)
+        status << juce::String((double)written / sampleRate, 1) << " s on disk";
+
+    if (dropped > 0)
+        status << ", dropped " << juce::String(dropped) << " frames";
+
+    if (capture.hasWriteFailed())
+        status << ", write failed";
+
+    captureLabel.setText(status, juce::dontSendNotification);
+}
+
+//Capture progress, and with DspStats the load since the last refresh and the worst
+//block since the last reset
+void BitDelayAudioProcessorEditor::timerCallback()
+{
+    updateCaptureStatus();
+
+    if (! DspStats::enabled)
+        return;
+
+    const auto stats = audioProcessor.getDspStats().getSnapshot();
+
+    //The counters restart after a reset or prepareToPlay
+    if (stats.numSamples < mLastStats.numSamples)
+        mLastStats = {};
+
+    DspStats::Snapshot recent;
+    recent.sampleRate = stats.sampleRate;
+    recent.numSamples = stats.numSamples - mLastStats.numSamples;
+    recent.totalNanoseconds = stats.totalNanoseconds - mLastStats.totalNanoseconds;
+    mLastStats = stats;
+
+    statsLabel.setText("DSP " + juce::String(100.0 * recent.getAverageLoad(), 2) + "%, peak "
+                           + juce::String(100.0 * stats.peakLoad, 1) + "%, worst block "
+                           + juce::String((double)stats.worstNanoseconds * 1.0e-3, 1) + " us / "
+                           + juce::String(stats.worstBlockSize) + ", overruns " + juce::String((juce::int64)stats.numOverruns),
+                       juce::dontSendNotification);
 }
 
 void BitDelayAudioProcessorEditor::retrieveParameterValues()
 {
-    auto parameters = processor.getParameters();
-    timeSlider.setValue(parameters[0]->getValue());
-    echoVolSlider.setValue(parameters[1]->getValue());
-    regenSlider.setValue(parameters[2]->getValue());
-    drySlider.setValue(parameters[3]->getValue());
-    wetSlider.setValue(parameters[4]->getValue());
+    for (auto& attachment : getSliderParameters())
+        attachment.slider->setValue(attachment.parameter->get(), juce::dontSendNotification);
+
+    interpolationBox.setSelectedId(juce::roundToInt(audioProcessor.getMainParameter(BitDelayAudioProcessor::mainInterpolation)->get()) + 1, juce::dontSendNotification);
+    decimationBox.setSelectedId(juce::roundToInt(audioProcessor.getMainParameter(BitDelayAudioProcessor::mainDecimation)->get()) + 1, juce::dontSendNotification);
+}
+
+//Sliders work in real units, the parameters convert to the host's 0..1 range
+juce::Array<BitDelayAudioProcessorEditor::SliderParameter> BitDelayAudioProcessorEditor::getSliderParameters()
+{
+    return { { &timeSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainTime) },
+             { &echoVolSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainVolume) },
+             { &regenSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainRegen) },
+             { &drySlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainDry) },
+             { &wetSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainWet) },
+             { &bitDepthSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainBitDepth) },
+             { &maxTimeSlider, audioProcessor.getMainParameter(BitDelayAudioProcessor::mainMaxTime) },
+             { &tapTimeSlider, audioProcessor.getTapParameter(mSelectedTap, BitDelayAudioProcessor::tapTime) },
+             { &tapLevelSlider, audioProcessor.getTapParameter(mSelectedTap, BitDelayAudioProcessor::tapLevel) },
+             { &tapPanSlider, audioProcessor.getTapParameter(mSelectedTap, BitDelayAudioProcessor::tapPan) } };
+}
+
+Echo_Parameter* BitDelayAudioProcessorEditor::getParameterFor(juce::Slider* slider)
+{
+    for (auto& attachment : getSliderParameters())
+        if (attachment.slider == slider)
+            return attachment.parameter;
+
+    return nullptr;
 }
 
 void BitDelayAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
 {
-    if (slider == &timeSlider)
-        processor.getParameters()[0]->setValue(slider->getValue());
-    else if (slider == &echoVolSlider)
-        processor.getParameters()[1]->setValue(slider->getValue());
-    else if (slider == &regenSlider)
-        processor.getParameters()[2]->setValue(slider->getValue());
-    else if (slider == &drySlider)
-        processor.getParameters()[3]->setValue(slider->getValue());
-    else if (slider == &wetSlider)
-        processor.getParameters()[4]->setValue(slider->getValue());
+    if (auto* parameter = getParameterFor(slider))
+        parameter->setRealValueNotifyingHost((float)slider->getValue());
+}
 
+void BitDelayAudioProcessorEditor::sliderDragStarted(juce::Slider* slider)
+{
+    if (auto* parameter = getParameterFor(slider))
+        parameter->beginChangeGesture();
+}
+
+void BitDelayAudioProcessorEditor::sliderDragEnded(juce::Slider* slider)
+{
+    if (auto* parameter = getParameterFor(slider))
+        parameter->endChangeGesture();
 }
@@ -9,96 +9,14 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CustomLookAndFeel.h"
 #include "PluginProcessor.h"
-
-class CustomLookAndFeel : public juce::LookAndFeel_V4
-{
-public:
-    CustomLookAndFeel()
-    {
-
-    }
-    void drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
-        const float rotaryStartAngle, const float rotaryEndAngle, juce::Slider&) override
-    {
-        auto radius = (float)juce::jmin(width / 2, height / 2) - 4.0f;
-        auto centreX = (float)x + (float)width * 0.5f;
-        auto centreY = (float)y + (float)height * 0.5f;
-        auto rx = centreX - radius;
-        auto ry = centreY - radius;
-        auto rw = radius * 2.0f;
-        auto angle = rotaryStartAngle + sliderPos * (rotaryEndAngle - rotaryStartAngle);
-
-        // fill
-        //g.setColour(juce::Colours::orange);
-        //g.fillEllipse(rx, ry, rw, rw);
-
-        // outline
-        g.setColour(juce::Colours::darkred);
-        g.drawEllipse(rx, ry, rw, rw, 2.0f);
-
-        juce::Path p;
-        auto pointerLength = radius * 0.33f;
-        auto pointerThickness = 2.0f;
-        p.addRectangle(-pointerThickness * 0.5f, -radius, pointerThickness, pointerLength);
-        p.applyTransform(juce::AffineTransform::rotation(angle).translated(centreX, centreY));
-
-        // pointer
-        g.setColour(juce::Colours::darkred);
-        g.fillPath(p);
-
-    }
-
-    void drawLinearSlider(juce::Graphics& g, int x, int y, int width, int height,
-        float sliderPos,
-        float minSliderPos,
-        float maxSliderPos,
-        const juce::Slider::SliderStyle style, juce::Slider& slider) override
-    {
-        auto trackWidth = juce::jmin(6.0f, slider.isHorizontal() ? (float)height * 0.25f : (float)width * 0.25f);
-        
-        juce::Point<float> startPoint(slider.isHorizontal() ? (float)x : (float)x + (float)width * 0.5f,
-            slider.isHorizontal() ? (float)y + (float)height * 0.5f : (float)(height + y));
-
-        juce::Point<float> endPoint(slider.isHorizontal() ? (float)(width + x) : startPoint.x,
-            slider.isHorizontal() ? startPoint.y : (float)y);
-
-        juce::Path backgroundTrack;
-        backgroundTrack.startNewSubPath(startPoint);
-        backgroundTrack.lineTo(endPoint);
-        g.setColour(juce::Colours::black);
-        g.strokePath(backgroundTrack, { trackWidth, juce::PathStrokeType::mitered, juce::PathStrokeType::square });
-
-        juce::Path valueTrack;
-        juce::Point<float> minPoint, maxPoint, thumbPoint;
-
-        auto kx = slider.isHorizontal() ? sliderPos : ((float)x + (float)width * 0.5f);
-        auto ky = slider.isHorizontal() ? ((float)y + (float)height * 0.5f) : sliderPos;
-
-        minPoint = startPoint;
-        maxPoint = { kx, ky };
-
-        auto thumbWidth = getSliderThumbRadius(slider);
-
-        valueTrack.startNewSubPath(minPoint);
-        valueTrack.lineTo(maxPoint);
-        g.setColour(juce::Colours::darkred);
-        g.strokePath(valueTrack, { trackWidth, juce::PathStrokeType::mitered, juce::PathStrokeType::square });
-        
-        g.setColour(juce::Colours::white);
-        g.fillEllipse(juce::Rectangle<float>(static_cast<float> (thumbWidth), static_cast<float> (thumbWidth)).withCentre(maxPoint));
-        
-        //if (slider.isBar())
-            //drawLinearSliderOutline(g, x, y, width, height, style, slider);
-    }
-
-
-};
+#include "ScopeComponent.h"
 
 //==============================================================================
 /**
 */
-class BitDelayAudioProcessorEditor : public juce::AudioProcessorEditor, public juce::Slider::Listener
+class BitDelayAudioProcessorEditor : public juce::AudioProcessorEditor, public juce::Slider::Listener, private juce::Timer
 {
 public:
     BitDelayAudioProcessorEditor(BitDelayAudioProcessor&);
@@ -108,9 +26,24 @@ public:
     void paint(juce::Graphics&) override;
     void resized() override;
     void sliderValueChanged(juce::Slider* slider) override;
-    void BitDelayAudioProcessorEditor::retrieveParameterValues();
+    void sliderDragStarted(juce::Slider* slider) override;
+    void sliderDragEnded(juce::Slider* slider) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void retrieveParameterValues();
 
 private:
+    struct SliderParameter
+    {
+        juce::Slider* slider;
+        Echo_Parameter* parameter;
+    };
+
+    juce::Array<SliderParameter> getSliderParameters();
+    Echo_Parameter* getParameterFor(juce::Slider* slider);
+    void timerCallback() override;
+    void toggleCapture();
+    void updateCaptureStatus();
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     BitDelayAudioProcessor& audioProcessor;
@@ -120,6 +53,8 @@ private:
     juce::Slider echoVolSlider;
     juce::Label regenLabel;
     juce::Slider regenSlider;
+    juce::Label bitDepthLabel;
+    juce::Slider bitDepthSlider;
 
     juce::Label dryLabel;
     juce::Slider drySlider;
@@ -127,6 +62,37 @@ private:
     juce::Label wetLabel;
     juce::Slider wetSlider;
 
+    juce::Label maxTimeLabel;
+    juce::Slider maxTimeSlider;
+
+    juce::Label interpolationLabel;
+    juce::ComboBox interpolationBox;
+
+    juce::Label decimationLabel;
+    juce::ComboBox decimationBox;
+    //One set of sliders for the extra taps, editing the tap picked in tapBox
+    juce::Label tapLabel;
+    juce::ComboBox tapBox;
+    juce::Label tapTimeLabel;
+    juce::Slider tapTimeSlider;
+    juce::Label tapLevelLabel;
+    juce::Slider tapLevelSlider;
+    juce::Label tapPanLabel;
+    juce::Slider tapPanSlider;
+    int mSelectedTap{ 0 };
+
+    ScopeComponent scope;
+
+    //Starts a capture into a file picked by the user (the line goes next to it), or stops it.
+    //The label shows how much is on disk and how much was dropped.
+    juce::TextButton captureButton{ "Capture" };
+    juce::Label captureLabel;
+    std::unique_ptr<juce::FileChooser> mCaptureChooser;
+
+    //DSP load readout, refreshed by the timer. Click it to reset the counters.
+    juce::Label statsLabel;
+    DspStats::Snapshot mLastStats;
+
     CustomLookAndFeel newLookAndFeel;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BitDelayAudioProcessorEditor)
 };
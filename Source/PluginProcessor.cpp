@@ -8,6 +8,47 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "AllocationGuard.h"
+
+namespace
+{
+    //Host samples into float scratch, converted on the way when the host sends doubles
+    void copyToFloat(float* dest, const float* source, int numSamples)
+    {
+        juce::FloatVectorOperations::copy(dest, source, numSamples);
+    }
+
+    void copyToFloat(float* dest, const double* source, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = (float)source[i];
+    }
+
+    //output = output * dryGains + wet * wetGains, the dry part in the host's precision
+    void mixDryAndWet(float* output, const float* wet, const float* dryGains, const float* wetGains, int numSamples)
+    {
+        juce::FloatVectorOperations::multiply(output, dryGains, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(output, wet, wetGains, numSamples);
+    }
+
+    //output += sum * wetGains
+    void addWet(float* output, const float* sum, const float* wetGains, int numSamples)
+    {
+        juce::FloatVectorOperations::addWithMultiply(output, sum, wetGains, numSamples);
+    }
+
+    void addWet(double* output, const float* sum, const float* wetGains, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            output[i] += (double)(sum[i] * wetGains[i]);
+    }
+
+    void mixDryAndWet(double* output, const float* wet, const float* dryGains, const float* wetGains, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            output[i] = output[i] * (double)dryGains[i] + (double)(wet[i] * wetGains[i]);
+    }
+}
 
 //==============================================================================
 BitDelayAudioProcessor::BitDelayAudioProcessor()
@@ -22,36 +63,47 @@ BitDelayAudioProcessor::BitDelayAudioProcessor()
     )
 #endif
 {
-    time = new Echo_Parameter();
-    time->defaultValue = 1.0f;
-    time->currentValue = 1.7f;
-    time->name = "Time";
+    time = new Echo_Parameter("Time", { 0.0f, timeRangeEnd }, 1.0f, timeRangeEnd);
     addParameter(time);
 
-    volume = new Echo_Parameter();
-    volume->defaultValue = 0.1f;
-    volume->currentValue = 0.7f;
-    volume->name = "Echo Volume";
+    volume = new Echo_Parameter("Echo Volume", { 0.0f, 0.7f }, 0.1f, 0.7f);
     addParameter(volume);
 
-    regen = new Echo_Parameter();
-    regen->defaultValue = 0.1f;
-    regen->currentValue = 0.7f;;
-    regen->name = "Regen";
+    regen = new Echo_Parameter("Regen", { 0.0f, 0.7f }, 0.1f, 0.7f);
     addParameter(regen);
 
-    dry = new Echo_Parameter();
-    dry->defaultValue = 0.0f;
-    dry->currentValue = 0.7f;;
-    dry->name = "Dry Volume";
+    dry = new Echo_Parameter("Dry Volume", { 0.0f, 0.7f }, 0.0f, 0.7f);
     addParameter(dry);
 
-    wet = new Echo_Parameter();
-    wet->defaultValue = 0.0f;
-    wet->currentValue = 0.7f;;
-    wet->name = "Wet Volume";
+    wet = new Echo_Parameter("Wet Volume", { 0.0f, 0.7f }, 0.0f, 0.7f);
     addParameter(wet);
 
+    bitDepth = new Echo_Parameter("Bit Depth", { 4.0f, 16.0f, 1.0f }, 8.0f, 8.0f);
+    addParameter(bitDepth);
+
+    interpolation = new Echo_Parameter("Interpolation", { 0.0f, (float)(DelayInterpolation::numModes - 1), 1.0f }, 1.0f, 1.0f,
+                                       { "None", "Linear", "Cubic", "Allpass" });
+    addParameter(interpolation);
+
+    maxTime = new Echo_Parameter("Max Time", { time->range.end, maxTimeLimit }, time->range.end, time->range.end);
+    addParameter(maxTime);
+
+    decimation = new Echo_Parameter("Decimation", { 0.0f, (float)(DecimationFilter::numModes - 1), 1.0f }, 0.0f, 0.0f,
+                                    { "Hold", "Clean", "Clean HQ" });
+    addParameter(decimation);
+
+    jassert(getParameters().size() == numMainParameters && getMainParameter(mainDecimation) == decimation);
+
+    //Extra taps start spread evenly over the Time range, silent until given a level
+    for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+    {
+        const juce::String prefix = "Tap " + juce::String(tap + 1) + " ";
+        const float tapTime = time->range.end * (float)(tap + 1) / (float)(MultiTap::maxTaps + 1);
+
+        addParameter(new Echo_Parameter(prefix + "Time", time->range, tapTime, tapTime));
+        addParameter(new Echo_Parameter(prefix + "Level", { 0.0f, 0.7f }, 0.0f, 0.0f));
+        addParameter(new Echo_Parameter(prefix + "Pan", { -1.0f, 1.0f }, 0.0f, 0.0f));
+    }
 }
 
 BitDelayAudioProcessor::~BitDelayAudioProcessor()
@@ -91,9 +143,61 @@ bool BitDelayAudioProcessor::isMidiEffect() const
 #endif
 }
 
+//Every repeat comes back regen times quieter than the one before. The tail ends
+//with the last repeat above the silence threshold.
 double BitDelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const double delaySeconds = (double)time->get() * maxTime->get() / time->range.end;
+    const double feedback = regen->get();
+
+    //The extra taps read the line directly, so they sound even without feedback
+    double longestTap = 0.0;
+
+    for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+        if (getTapParameter(tap, tapLevel)->get() > 0.0f)
+            longestTap = juce::jmax(longestTap, (double)getTapParameter(tap, tapTime)->get() * maxTime->get() / time->range.end);
+
+    if (delaySeconds <= 0.0 || feedback <= 0.0)
+        return longestTap;
+
+    const auto numRepeats = std::ceil(std::log((double)DelayEnergyTracker::silenceThreshold) / std::log(feedback));
+    const double tail = delaySeconds * juce::jmax(1.0, numRepeats);
+
+    //A tap hears what is left in the line up to its own delay after the last repeat was written
+    return juce::jmax(tail, tail - delaySeconds + longestTap);
+}
+
+double BitDelayAudioProcessor::getPreRollSeconds() const
+{
+    const double delaySeconds = (double)time->get() * maxTime->get() / time->range.end;
+    const double feedback = regen->get();
+    double longestDelay = delaySeconds;
+
+    for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+        if (getTapParameter(tap, tapLevel)->get() > 0.0f)
+            longestDelay = juce::jmax(longestDelay, (double)getTapParameter(tap, tapTime)->get() * maxTime->get() / time->range.end);
+
+    //The echo of a sample comes back numRepeats times through the feedback
+    double repeats = 0.0;
+
+    if (feedback > 0.0)
+        repeats = delaySeconds * juce::jmax(1.0, std::ceil(std::log((double)DelayEnergyTracker::silenceThreshold) / std::log(feedback)));
+
+    const int rateDivide = (int)derivateSampleRate(getSampleRate(), time->get());
+    const double filterSeconds = (double)(DecimationFilter::getTapsPerPhase(getDecimationMode()) * rateDivide) / getSampleRate();
+
+    return longestDelay + repeats + filterSeconds;
+}
+
+MultiTap::TapSettings BitDelayAudioProcessor::getTapSettings() const
+{
+    MultiTap::TapSettings settings;
+
+    for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+        settings[(size_t)tap] = { getTapParameter(tap, tapTime)->get(), getTapParameter(tap, tapLevel)->get(),
+                                  getTapParameter(tap, tapPan)->get() };
+
+    return settings;
 }
 
 int BitDelayAudioProcessor::getNumPrograms()
@@ -123,9 +227,67 @@ void BitDelayAudioProcessor::changeProgramName(int index, const juce::String& ne
 //==============================================================================
 void BitDelayAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    auto delayBufferSize = 2.0f * sampleRate; //Our buffer is the size of 2 seconds worth of audio, for a 2 second delay
-    mDelayBuffer.setSize(getTotalNumInputChannels(), (int)delayBufferSize);
-    mDelayBuffer.clear();
+    //All scratch storage used by processBlock is allocated here, never on the audio thread
+    mMaxChunkSize = juce::jlimit(1, maxChunkSize, samplesPerBlock);
+
+    const int numChannels = getTotalNumInputChannels();
+    mActiveStorage = mDelayStorage;
+    mUseInterleavedDelay = mActiveStorage == DelayStorage::full
+                           && (mChannelProcessing == ChannelProcessing::interleaved
+                               || (mChannelProcessing == ChannelProcessing::automatic && numChannels >= InterleavedDelay::numLanes));
+
+    //Only the storage that is going to run gets memory. mDelayLine also wraps tap
+    //positions for the interleaved engine, so it keeps its length without channels.
+    const int delayBufferLength = getRequiredDelayLength(maxTime->get());
+    const bool perChannelFull = mActiveStorage == DelayStorage::full && ! mUseInterleavedDelay;
+    mDelayLine.prepare(perChannelFull ? numChannels : 0, delayBufferLength, mMaxChunkSize);
+    mCompactDelayLine.prepare(mActiveStorage == DelayStorage::compact ? numChannels : 0, delayBufferLength, sampleRate);
+    mPooledDelayLine.prepare(mActiveStorage == DelayStorage::pooled ? numChannels : 0, delayBufferLength,
+                             getRequiredDelayLength(maxTime->range.end));
+    mExpandBuffer.assign(mActiveStorage != DelayStorage::full ? (size_t)(mMaxChunkSize + DelayLine::interpolationPadding) : 0, 0.0f);
+
+    mUseFusedFeedback = mFusedFeedback && perChannelFull;
+    mWetBuffer.setSize(mUseInterleavedDelay || mUseFusedFeedback ? 0 : numChannels, mMaxChunkSize);
+    mDecimatedBuffer.setSize(mUseInterleavedDelay || mUseFusedFeedback ? 0 : 1, mMaxChunkSize);
+    mTapBuffer.setSize(mUseInterleavedDelay ? 0 : 1, mMaxChunkSize);
+    mAllpassStates.assign((size_t)numChannels, 0.0f);
+    mScopeBuffer.setSize(numScopeSignals, mMaxChunkSize);
+    mCaptureBuffer.setSize(numChannels * 2, mMaxChunkSize);
+    mDelayCapture.prepare(numChannels, sampleRate);
+    mDecimator.prepare(numChannels);
+
+    //The longest Time setting has the largest rate divide the clean filters need
+    const int maxRateDivide = (int)derivateSampleRate(sampleRate, time->range.end);
+    mDecimationFilter.prepare(mUseInterleavedDelay ? 0 : numChannels, 1, maxRateDivide, mMaxChunkSize);
+    mDecimationMode = getDecimationMode();
+
+    mWritePosition = 0;
+    updateDelayScale();
+    mEnergyTracker.reset();
+    mSleeping = false;
+    mDspStats.prepare(sampleRate);
+
+    mSmoothedValues.setSize(numSmoothedParameters, mMaxChunkSize);
+    mSmoothedValues.clear();
+    mReadIndices.assign((size_t)mMaxChunkSize, 0);
+    mReadFractions.assign((size_t)mMaxChunkSize, 0.0f);
+    mInterpolation = getInterpolation();
+    mTimeSmoother.reset(sampleRate, timeSmoothingSeconds, time->get());
+    mRegenSmoother.reset(sampleRate, gainSmoothingSeconds, regen->get());
+    mDrySmoother.reset(sampleRate, gainSmoothingSeconds, dry->get());
+    mWetSmoother.reset(sampleRate, gainSmoothingSeconds, wet->get());
+
+    if (mUseInterleavedDelay)
+        mInterleavedDelay.prepare(numChannels, delayBufferLength, mMaxChunkSize, maxRateDivide);
+    else
+        mInterleavedDelay.prepare(0, 0, 0);
+
+    //The interleaved engine's taps are gathered a whole group of lanes at a time
+    const int tapLanes = mUseInterleavedDelay ? InterleavedDelay::numLanes : 1;
+    const int tapChannels = (numChannels + tapLanes - 1) / tapLanes * tapLanes;
+    mMultiTap.prepare(tapChannels, tapLanes, numChannels == 2, mMaxChunkSize, sampleRate,
+                      timeSmoothingSeconds, gainSmoothingSeconds, getTapSettings());
+    mTapSum.assign((size_t)(mMaxChunkSize * tapLanes), 0.0f);
 }
 
 void BitDelayAudioProcessor::releaseResources()
@@ -141,12 +303,9 @@ bool BitDelayAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
     juce::ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works (mono, stereo, surround, ambisonics...) as long as
+    // the main output isn't disabled, every channel is delayed independently.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -162,66 +321,398 @@ bool BitDelayAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts)
 
 void BitDelayAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    processSamples(buffer);
+}
+
+//Hosts that run in double precision get the same engines; their buffers are
+//processed where they are, without being converted to float and back
+void BitDelayAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer);
+}
+
+template <typename SampleType>
+void BitDelayAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
+{
+    BITDELAY_SCOPED_NO_ALLOCATION;
+    BITDELAY_SCOPED_DSP_STATS(mDspStats, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
-    int bitDepth = 8; //8 Bit delay
-    float rateDivide = derivateSampleRate(getSampleRate());
 
-    juce::AudioBuffer<float> wetBuffer;
-    wetBuffer.makeCopyOf(buffer);
-    juce::AudioBuffer<float> dryBuffer;
-    dryBuffer.makeCopyOf(buffer);
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear(i, 0, buffer.getNumSamples());
 
+    jassert(mMaxChunkSize > 0); //prepareToPlay has to run before processing
+    if (mMaxChunkSize <= 0)
+        return;
 
+    //Worked through in chunks that fit the preallocated scratch buffers, which also
+    //covers hosts that send bigger blocks than announced in prepareToPlay
+    const int numSamples = buffer.getNumSamples();
+    for (int startSample = 0; startSample < numSamples; startSample += mMaxChunkSize)
+        processChunk(buffer, startSample, juce::jmin(mMaxChunkSize, numSamples - startSample));
+}
 
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear(i, 0, buffer.getNumSamples());
+template <typename SampleType>
+void BitDelayAudioProcessor::processChunk(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples)
+{
+    //A pooled line picks up chunks the background thread has prepared (or drops them)
+    if (mActiveStorage == DelayStorage::pooled)
+    {
+        mPooledDelayLine.setRequiredLength(getRequiredDelayLength(maxTime->get()));
+        mPooledDelayLine.update(mWritePosition);
+    }
+
+    updateDelayScale();
+
+    if (mEnergyTracker.isLineSilent(getDelayBufferLength()) && isInputSilent(buffer, startSample, numSamples))
+    {
+        processSilentChunk(buffer, startSample, numSamples);
+        return;
+    }
+
+    mSleeping = false;
+    mMultiTap.setTargets(getTapSettings());
+
+    //Rate reduction follows the smoothed delay time, picked once per chunk
+    const int rateDivide = (int)derivateSampleRate(getSampleRate(), mTimeSmoother.getCurrentValue());
+    //Picks the specialised kernel for this bit depth once per chunk
+    mDecimator.setParameters(juce::roundToInt(bitDepth->get()), rateDivide);
+
+    //A switched on clean decimation starts its filters from silence
+    if (getDecimationMode() != mDecimationMode)
+    {
+        mDecimationMode = getDecimationMode();
+        mDecimationFilter.reset();
+    }
 
-    const int bufferLength = buffer.getNumSamples();
-    const int delayBufferLength = mDelayBuffer.getNumSamples();
+    mInterleavedDelay.setDecimation(juce::roundToInt(bitDepth->get()), rateDivide, mDecimationMode);
 
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    //The blockwise engines only hear feedback written before the span they work on,
+    //so their spans are kept shorter than the delay
+    const int maxSpan = mUseFusedFeedback ? numSamples : getMaxBlockwiseSpan();
+
+    //The silence count goes by whole chunks, so every engine falls asleep at the same sample
+    float peak = 0.0f;
+
+    for (int offset = 0; offset < numSamples; offset += maxSpan)
+        peak = juce::jmax(peak, processSpan(buffer, startSample + offset, juce::jmin(maxSpan, numSamples - offset), rateDivide));
+
+    mEnergyTracker.addBlock(peak, numSamples);
+}
+
+//Longest span whose taps all read frames from before the span, with a sample to
+//spare for rounding in the smoothed delay
+int BitDelayAudioProcessor::getMaxBlockwiseSpan() const
+{
+    const auto mode = getInterpolation();
+    const float shortestTime = juce::jmin(mTimeSmoother.getCurrentValue(), mTimeSmoother.getTargetValue(), time->get());
+    const double shortestDelay = (double)shortestTime * getSampleRate() * mDelayScale;
+
+    return juce::jmax(1, (int)shortestDelay - DelayInterpolation::getMinimumDelay(mode));
+}
+
+//Returns the peak level written into the delay line
+template <typename SampleType>
+float BitDelayAudioProcessor::processSpan(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int rateDivide)
+{
+    auto totalNumInputChannels = getTotalNumInputChannels();
+    const int bufferLength = numSamples;
+    const int delayBufferLength = getDelayBufferLength();
+
+    //A switched interpolation mode starts its allpass from rest
+    if (getInterpolation() != mInterpolation)
+    {
+        mInterpolation = getInterpolation();
+        std::fill(mAllpassStates.begin(), mAllpassStates.end(), 0.0f);
+        mInterleavedDelay.resetInterpolation();
+    }
+
+    updateSmoothedParameters(bufferLength);
+    auto* feedback = mSmoothedValues.getReadPointer(feedbackIndex);
+    auto* dryGains = mSmoothedValues.getReadPointer(dryIndex);
+    auto* wetGains = mSmoothedValues.getReadPointer(wetIndex);
+    float peak = 0.0f;
+
+    //The engines overwrite the input, the scope and the capture need it to take the dry part back out
+    const bool feedScope = mScopeFifo.isActive() && totalNumInputChannels > 0;
+    if (feedScope)
+        copyToFloat(mScopeBuffer.getWritePointer(scopeInputIndex), buffer.getReadPointer(0, startSample), bufferLength);
+
+    const bool feedCapture = mDelayCapture.isCapturing();
+    if (feedCapture)
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+            copyToFloat(mCaptureBuffer.getWritePointer(channel), buffer.getReadPointer(channel, startSample), bufferLength);
+
+    if (mUseInterleavedDelay)
+    {
+        peak = mInterleavedDelay.process(buffer, startSample, bufferLength, mWritePosition,
+                                         { feedback, dryGains, wetGains, mInterpolation, getTapPositions() });
+    }
+    else if (mUseFusedFeedback)
+    {
+        FeedbackKernel::Parameters parameters{ feedback, dryGains, wetGains, mInterpolation, getTapPositions(),
+                                               juce::roundToInt(bitDepth->get()), rateDivide };
+
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        {
+            auto* channelData = buffer.getWritePointer(channel, startSample);
+
+            //The band-limited hold, and quantizing without a hold (Decimator's per-depth
+            //kernels), run ahead of the kernel, which takes their output as given
+            if (mDecimationMode != DecimationFilter::Mode::hold || rateDivide <= 1)
+            {
+                copyToFloat(mTapBuffer.getWritePointer(0), channelData, bufferLength);
+                decimateChannel(channel, mTapBuffer.getWritePointer(0), bufferLength, rateDivide);
+                parameters.decimated = mTapBuffer.getReadPointer(0);
+            }
+
+            peak = juce::jmax(peak, FeedbackKernel::process(mDelayLine, channel, mWritePosition, channelData, bufferLength, parameters,
+                                                            mDecimator.getChannelState(channel), mAllpassStates[(size_t)channel]));
+        }
+    }
+    else
     {
-        auto* originalBufferData = buffer.getWritePointer(channel);
-        auto* bufferData = wetBuffer.getWritePointer(channel);
-        auto* dryBufferData = dryBuffer.getWritePointer(channel);
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        {
+            auto* originalBufferData = buffer.getWritePointer(channel, startSample);
+            auto* bufferData = mWetBuffer.getWritePointer(channel);
+            auto* decimatedData = mDecimatedBuffer.getWritePointer(0);
+
+            //wetBuffer.applyGainRamp(channel, 0, bufferLength, lastInputGain, volume->get());
+            //lastInputGain = volume->get();
+
+            //The decimated input is kept aside to take it back out of the wet signal,
+            //instead of crushing the original a second time
+            copyToFloat(bufferData, originalBufferData, bufferLength);
+            decimateChannel(channel, bufferData, bufferLength, rateDivide);
+            juce::FloatVectorOperations::copy(decimatedData, bufferData, bufferLength);
+            readFromBuffer(channel, bufferLength, delayBufferLength, mWetBuffer);
+
+            fillBuffer(channel, bufferLength, delayBufferLength, bufferData);
+            peak = juce::jmax(peak, DelayEnergyTracker::getPeak(bufferData, bufferLength));
+            juce::FloatVectorOperations::subtract(bufferData, decimatedData, bufferLength);
+
+            //Add dry and wet
+            mixDryAndWet(originalBufferData, bufferData, dryGains, wetGains, bufferLength);
+        }
+    }
+
+    if (mMultiTap.isActive())
+        addTaps(buffer, startSample, bufferLength, wetGains);
+
+    if (feedScope)
+        pushToScope(buffer.getReadPointer(0, startSample), dryGains, bufferLength);
+
+    if (feedCapture)
+        pushToCapture(buffer, startSample, dryGains, bufferLength);
+
+    mWritePosition = (mWritePosition + bufferLength) & getDelayMask();
+    return peak;
+}
+
+//The extra taps read what the engine has just written, so any tap at least the
+//interpolation's minimum delay long hears the span itself
+template <typename SampleType>
+void BitDelayAudioProcessor::addTaps(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const float* wetGains)
+{
+    const int numChannels = getTotalNumInputChannels();
+    auto* sum = mTapSum.data();
+    mMultiTap.update(mInterpolation, mWritePosition, getSampleRate() * mDelayScale, getDelayMask(), numSamples);
 
-        //wetBuffer.applyGainRamp(channel, 0, bufferLength, lastInputGain, volume->getValue());
-        //lastInputGain = volume->getValue();
+    if (mUseInterleavedDelay)
+    {
+        constexpr int numLanes = InterleavedDelay::numLanes;
+        const auto& delayLine = mInterleavedDelay.getDelayLine();
 
-        fillBuffer(channel, bufferLength, delayBufferLength, bufferData);
-        for (int i = 0; i < bufferLength; i++)
+        for (int firstChannel = 0; firstChannel < numChannels; firstChannel += numLanes)
         {
-            decimate(bufferData, bitDepth, rateDivide, i);
-            decimate(originalBufferData, bitDepth, rateDivide, i);
+            const int group = firstChannel / numLanes;
+
+            mMultiTap.gather<numLanes>(firstChannel, [&](const DelayInterpolation::TapPositions& taps, float* dest, float* allpassState)
+            {
+                DelayInterpolation::read<numLanes>(mInterpolation, delayLine, group, taps, dest, numSamples, allpassState);
+            }, sum, numSamples);
+
+            for (int lane = 0; lane < juce::jmin(numLanes, numChannels - firstChannel); ++lane)
+            {
+                auto* channelData = buffer.getWritePointer(firstChannel + lane, startSample);
+
+                for (int i = 0; i < numSamples; ++i)
+                    channelData[i] += (SampleType)(sum[i * numLanes + lane] * wetGains[i]);
+            }
         }
-        readFromBuffer(channel, bufferLength, delayBufferLength, wetBuffer);
 
-        fillBuffer(channel, bufferLength, delayBufferLength, bufferData);
-        juce::FloatVectorOperations::subtract(bufferData, originalBufferData, bufferLength);
+        return;
+    }
 
-        //Add dry
-        buffer.copyFromWithRamp(channel, 0, dryBufferData, bufferLength, lastDryGain, dry->getValue());
-        lastDryGain = dry->getValue();
-        //Add wet
-        buffer.addFromWithRamp(channel, 0, bufferData, bufferLength, lastWetGain, wet->getValue());
-        lastWetGain = wet->getValue();
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        mMultiTap.gather<1>(channel, [&](const DelayInterpolation::TapPositions& taps, float* dest, float* allpassState)
+        {
+            switch (mActiveStorage)
+            {
+                case DelayStorage::compact: readExpandedTaps(mCompactDelayLine, channel, taps, dest, numSamples, allpassState); break;
+                case DelayStorage::pooled:  readExpandedTaps(mPooledDelayLine, channel, taps, dest, numSamples, allpassState); break;
+                case DelayStorage::full:
+                    DelayInterpolation::read<1>(mInterpolation, mDelayLine, channel, taps, dest, numSamples, allpassState);
+                    break;
+            }
+        }, sum, numSamples);
+
+        addWet(buffer.getWritePointer(channel, startSample), sum, wetGains, numSamples);
     }
+}
+
+//Wet is the output minus the dry part, the line signal is what the engine has just
+//written into the first channel's delay line (decimated input plus feedback)
+template <typename SampleType>
+void BitDelayAudioProcessor::pushToScope(const SampleType* output, const float* dryGains, int numSamples)
+{
+    auto* wet = mScopeBuffer.getWritePointer(scopeWetIndex);
+    auto* line = mScopeBuffer.getWritePointer(scopeLineIndex);
+
+    //line holds the output as float until the delay line is read into it
+    copyToFloat(line, output, numSamples);
+    juce::FloatVectorOperations::multiply(wet, mScopeBuffer.getReadPointer(scopeInputIndex), dryGains, numSamples);
+    juce::FloatVectorOperations::subtract(wet, line, wet, numSamples);
+    readWrittenFrames(0, line, numSamples);
 
-    mWritePosition += bufferLength;
-    mWritePosition %= delayBufferLength;
+    mScopeFifo.push(wet, line, numSamples);
 }
 
+//Same as the scope, for every channel
+template <typename SampleType>
+void BitDelayAudioProcessor::pushToCapture(const juce::AudioBuffer<SampleType>& buffer, int startSample, const float* dryGains, int numSamples)
+{
+    const int numChannels = getTotalNumInputChannels();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* wet = mCaptureBuffer.getWritePointer(channel);
+        auto* line = mCaptureBuffer.getWritePointer(numChannels + channel);
+
+        copyToFloat(line, buffer.getReadPointer(channel, startSample), numSamples);
+        juce::FloatVectorOperations::multiply(wet, dryGains, numSamples);
+        juce::FloatVectorOperations::subtract(wet, line, wet, numSamples);
+        readWrittenFrames(channel, line, numSamples);
+    }
+
+    const auto* const* signals = mCaptureBuffer.getArrayOfReadPointers();
+    mDelayCapture.push(signals, signals + numChannels, numSamples);
+}
+
+//The numSamples frames the engine has just written into a channel's delay line
+void BitDelayAudioProcessor::readWrittenFrames(int channel, float* dest, int numSamples) const
+{
+    switch (mActiveStorage)
+    {
+        case DelayStorage::compact: mCompactDelayLine.read(channel, mWritePosition, dest, numSamples); break;
+        case DelayStorage::pooled:  mPooledDelayLine.read(channel, mWritePosition, dest, numSamples); break;
+        case DelayStorage::full:
+            if (mUseInterleavedDelay)
+                mInterleavedDelay.readChannel(channel, mWritePosition, dest, numSamples);
+            else
+                juce::FloatVectorOperations::copy(dest, mDelayLine.getReadPointer(channel, mWritePosition), numSamples);
+            break;
+    }
+}
+
+//While asleep the delay line is left alone and the parameters jump to their targets,
+//since nothing audible depends on them. The write position and the hold phase still
+//move on as if the chunk had been processed, so where they stand only depends on the
+//number of samples since prepareToPlay (segmented offline renders rely on that).
+template <typename SampleType>
+void BitDelayAudioProcessor::processSilentChunk(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples)
+{
+    mSleeping = true;
+    mScopeFifo.pushSilence(numSamples);
+    mDelayCapture.pushSilence(numSamples);
+
+    mTimeSmoother.setTargetValue(time->get());
+    mRegenSmoother.setTargetValue(regen->get());
+    mDrySmoother.setTargetValue(dry->get());
+    mWetSmoother.setTargetValue(wet->get());
+    mTimeSmoother.snapToTarget();
+    mRegenSmoother.snapToTarget();
+    mDrySmoother.snapToTarget();
+    mWetSmoother.snapToTarget();
+    mMultiTap.setTargets(getTapSettings());
+    mMultiTap.snapToTargets();
+
+    const int rateDivide = (int)derivateSampleRate(getSampleRate(), mTimeSmoother.getCurrentValue());
+    mDecimator.setParameters(juce::roundToInt(bitDepth->get()), rateDivide);
+    mDecimator.skip(numSamples);
+    mInterleavedDelay.setDecimation(juce::roundToInt(bitDepth->get()), rateDivide, mDecimationMode);
+    mInterleavedDelay.skip(numSamples);
+    mWritePosition = (mWritePosition + numSamples) & getDelayMask();
+
+    for (int channel = 0; channel < getTotalNumInputChannels(); ++channel)
+        buffer.applyGain(channel, startSample, numSamples, (SampleType)mDrySmoother.getCurrentValue());
+}
+
+template <typename SampleType>
+bool BitDelayAudioProcessor::isInputSilent(const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples) const
+{
+    for (int channel = 0; channel < getTotalNumInputChannels(); ++channel)
+        if (! DelayEnergyTracker::isSilent(DelayEnergyTracker::getPeak(buffer.getReadPointer(channel, startSample), numSamples)))
+            return false;
+
+    return true;
+}
+
+//Fills mSmoothedValues with this chunk's per-sample parameter values. While the
+//delay time moves, every sample gets its own tap position in mReadIndices/mReadFractions.
+void BitDelayAudioProcessor::updateSmoothedParameters(int bufferLength)
+{
+    mTimeSmoother.setTargetValue(time->get());
+    mRegenSmoother.setTargetValue(regen->get());
+    mDrySmoother.setTargetValue(dry->get());
+    mWetSmoother.setTargetValue(wet->get());
+
+    mTimeIsSmoothing = mTimeSmoother.isSmoothing();
+
+    auto* times = mSmoothedValues.getWritePointer(timeIndex);
+    mTimeSmoother.process(times, bufferLength);
+    mRegenSmoother.process(mSmoothedValues.getWritePointer(feedbackIndex), bufferLength);
+    mDrySmoother.process(mSmoothedValues.getWritePointer(dryIndex), bufferLength);
+    mWetSmoother.process(mSmoothedValues.getWritePointer(wetIndex), bufferLength);
+
+    if (mTimeIsSmoothing)
+        DelayInterpolation::fillTapPositions(mInterpolation, mWritePosition, times, getSampleRate() * mDelayScale, getDelayMask(),
+                                             mReadIndices.data(), mReadFractions.data(), bufferLength);
+}
+
+//Decimator's plain hold, or the band-limited one of DecimationFilter, which keeps
+//the hold phase in the same state so it carries over when the mode changes
+void BitDelayAudioProcessor::decimateChannel(int channel, float* channelData, int numSamples, int rateDivide)
+{
+    if (mDecimationMode == DecimationFilter::Mode::hold)
+    {
+        mDecimator.process(channel, channelData, numSamples);
+        return;
+    }
+
+    auto& state = mDecimator.getChannelState(channel);
+    mDecimationFilter.process<1>(mDecimationMode, channel, channelData, numSamples, &state.heldValue, state.holdCounter,
+                                 juce::roundToInt(bitDepth->get()), rateDivide);
+}
 
 //Helper methods to get correct Sample Rate
 float BitDelayAudioProcessor::derivateSampleRate(double masterSampleRate)
 {
-    float givenSampleRate = 22050.0f - (22050.0f*time->getValue()*0.5f);
+    return derivateSampleRate(masterSampleRate, time->get());
+}
+
+float BitDelayAudioProcessor::derivateSampleRate(double masterSampleRate, float delayTime)
+{
+    float givenSampleRate = 22050.0f - (22050.0f*delayTime*0.5f);
     float rateDivide = masterSampleRate / givenSampleRate;
     return rateDivide;
 }
 
+//Per-sample reference version of the Decimator kernel, kept for comparisons
 void BitDelayAudioProcessor::decimate(float* channelData, int bitDepth, int rateDivide, int i)
 {
     float totalQLevels = powf(2, bitDepth);
@@ -237,66 +728,123 @@ void BitDelayAudioProcessor::decimate(float* channelData, int bitDepth, int rate
 
 void BitDelayAudioProcessor::fillBufferWithRamp(int channel, int bufferLength, int delayBufferLength, float* bufferData)
 {
+    //ramp into scratch first, the delay line takes care of the wrap
+    mTapBuffer.copyFromWithRamp(0, 0, bufferData, bufferLength, lastInputGain, volume->get());
+    fillBuffer(channel, bufferLength, delayBufferLength, mTapBuffer.getWritePointer(0));
+    lastInputGain = volume->get();
+}
+
+void BitDelayAudioProcessor::fillBuffer(int channel, int bufferLength, int delayBufferLength, float* bufferData)
+{
+    jassert(delayBufferLength == getDelayBufferLength());
+
     //copy the data from main buffer to delay buffer
-    if (delayBufferLength > bufferLength + mWritePosition)
+    switch (mActiveStorage)
     {
-        mDelayBuffer.copyFromWithRamp(channel, mWritePosition, bufferData, bufferLength, lastInputGain, volume->getValue());
+        case DelayStorage::compact: mCompactDelayLine.write(channel, mWritePosition, bufferData, bufferLength); break;
+        case DelayStorage::pooled:  mPooledDelayLine.write(channel, mWritePosition, bufferData, bufferLength); break;
+        case DelayStorage::full:    mDelayLine.write(channel, mWritePosition, bufferData, bufferLength); break;
     }
-    else
-    {
-        auto numSamplesToEnd = delayBufferLength - mWritePosition;
-        //copy just alittle bit of whats left to fillout the end
-        mDelayBuffer.copyFromWithRamp(channel, mWritePosition, bufferData, numSamplesToEnd, lastInputGain, volume->getValue());
+}
 
-        auto numSamplesAtStart = bufferLength - numSamplesToEnd;
-        //circle back and add whats left to the beginning again
-        mDelayBuffer.copyFromWithRamp(channel, 0, bufferData + numSamplesToEnd, numSamplesAtStart, lastInputGain, volume->getValue());
+int BitDelayAudioProcessor::getDelayMask() const
+{
+    switch (mActiveStorage)
+    {
+        case DelayStorage::compact: return mCompactDelayLine.getLength() - 1;
+        case DelayStorage::pooled:  return mPooledDelayLine.getMask();
+        case DelayStorage::full:    break;
     }
-    lastInputGain = volume->getValue();
+
+    return mDelayLine.getMask();
 }
 
-void BitDelayAudioProcessor::fillBuffer(int channel, int bufferLength, int delayBufferLength, float* bufferData)
+//Frames a delay line needs for maxTimeSeconds of delay plus one chunk and the
+//interpolation window, never less than the original 2 seconds
+int BitDelayAudioProcessor::getRequiredDelayLength(float maxTimeSeconds) const
 {
-    //copy the data from main buffer to delay buffer
-    if (delayBufferLength > bufferLength + mWritePosition)
+    const auto sampleRate = getSampleRate();
+    return juce::jmax((int)(2.0f * sampleRate),
+                      (int)(maxTimeSeconds * sampleRate) + mMaxChunkSize + DelayLine::interpolationPadding);
+}
+
+//The Time knob covers 0..Max Time, limited to what the delay line can hold right
+//now (a pooled line may still be growing, full storage is sized in prepareToPlay)
+void BitDelayAudioProcessor::updateDelayScale()
+{
+    const int capacity = mActiveStorage == DelayStorage::pooled ? mPooledDelayLine.getMaximumDelay() : getDelayBufferLength();
+    const double availableSeconds = (capacity - mMaxChunkSize - DelayLine::interpolationPadding) / getSampleRate();
+
+    mDelayScale = juce::jmin((double)maxTime->get(), availableSeconds) / time->range.end;
+}
+
+//Where this chunk's delay taps are. A steady delay time gives one start position and
+//fraction for the whole chunk, computed once.
+DelayInterpolation::TapPositions BitDelayAudioProcessor::getTapPositions() const
+{
+    DelayInterpolation::TapPositions taps;
+
+    if (mTimeIsSmoothing)
     {
-        mDelayBuffer.copyFrom(channel, mWritePosition, bufferData, bufferLength);
+        taps.indices = mReadIndices.data();
+        taps.fractions = mReadFractions.data();
+        return taps;
     }
-    else
-    {
-        auto numSamplesToEnd = delayBufferLength - mWritePosition;
-        //copy just alittle bit of whats left to fillout the end
-        mDelayBuffer.copyFrom(channel, mWritePosition, bufferData, numSamplesToEnd);
 
-        auto numSamplesAtStart = bufferLength - numSamplesToEnd;
-        //circle back and add whats left to the beginning again
-        mDelayBuffer.copyFrom(channel, 0, bufferData + numSamplesToEnd, numSamplesAtStart);
-    }
+    //original auto readPosition = mWritePosition - getSampleRate();
+    DelayInterpolation::getTapPosition(mInterpolation, mWritePosition, getSampleRate() * mDelayScale * mTimeSmoother.getTargetValue(),
+                                       getDelayMask(), taps.startIndex, taps.fraction);
+    return taps;
 }
 
-//Add audio back into main buffer
-void BitDelayAudioProcessor::readFromBuffer(int channel, int bufferLength, int delayBufferLength, juce::AudioBuffer<float>& buffer)
+//Compact and pooled storage have no guard region, so taps are copied out (and
+//expanded) before interpolating: once for the whole window while the time is
+//steady, tap by tap while it moves
+template <typename Storage>
+void BitDelayAudioProcessor::readExpandedTaps(const Storage& storage, int channel, const DelayInterpolation::TapPositions& taps,
+                                              float* dest, int numSamples, float* allpassState)
 {
-    //original auto readPosition = mWritePosition - getSampleRate();
-    auto readPosition = mWritePosition - (getSampleRate() * time->getValue());
-    if (readPosition < 0)
-        readPosition += delayBufferLength;
-
-    auto g = lastFeedbackGain;
-    lastFeedbackGain = regen->getValue();
-    //
-    if (readPosition + bufferLength < delayBufferLength)
+    const int framesBefore = DelayInterpolation::getFramesBefore(mInterpolation);
+    const int framesPerTap = DelayInterpolation::getFramesPerTap(mInterpolation);
+
+    if (taps.indices == nullptr)
     {
-        buffer.addFromWithRamp(channel, 0, mDelayBuffer.getReadPointer(channel, readPosition), bufferLength, g, g);
+        storage.read(channel, taps.startIndex - framesBefore, mExpandBuffer.data(), numSamples + framesPerTap - 1);
+        DelayInterpolation::readSteady<1>(mInterpolation, mExpandBuffer.data(), taps.fraction, dest, numSamples, allpassState);
+        return;
     }
-    else
+
+    float frames[4];
+
+    for (int i = 0; i < numSamples; ++i)
     {
-        auto numSamplesToEnd = delayBufferLength - readPosition;
-        buffer.addFromWithRamp(channel, 0, mDelayBuffer.getReadPointer(channel, readPosition), numSamplesToEnd, g, g);
+        storage.read(channel, taps.indices[i] - framesBefore, frames, framesPerTap);
+        DelayInterpolation::readTap<1>(mInterpolation, frames, taps.fractions[i], dest + i, allpassState);
+    }
+}
 
-        auto numSamplesAtStart = bufferLength - numSamplesToEnd;
-        buffer.addFromWithRamp(channel, numSamplesToEnd, mDelayBuffer.getReadPointer(channel, 0), numSamplesAtStart, g, g);
+//Add audio back into main buffer, scaled by the smoothed regen
+void BitDelayAudioProcessor::readFromBuffer(int channel, int bufferLength, int delayBufferLength, juce::AudioBuffer<float>& buffer)
+{
+    auto* feedback = mSmoothedValues.getReadPointer(feedbackIndex);
+    auto* bufferData = buffer.getWritePointer(channel);
+    auto* taps = mTapBuffer.getWritePointer(0);
+    jassert(delayBufferLength == getDelayBufferLength());
+
+    switch (mActiveStorage)
+    {
+        case DelayStorage::compact:
+            readExpandedTaps(mCompactDelayLine, channel, getTapPositions(), taps, bufferLength, &mAllpassStates[(size_t)channel]);
+            break;
+        case DelayStorage::pooled:
+            readExpandedTaps(mPooledDelayLine, channel, getTapPositions(), taps, bufferLength, &mAllpassStates[(size_t)channel]);
+            break;
+        case DelayStorage::full:
+            DelayInterpolation::read<1>(mInterpolation, mDelayLine, channel, getTapPositions(),
+                                        taps, bufferLength, &mAllpassStates[(size_t)channel]);
+            break;
     }
+    juce::FloatVectorOperations::addWithMultiply(bufferData, taps, feedback, bufferLength);
 }
 
 //==============================================================================
@@ -311,17 +859,16 @@ juce::AudioProcessorEditor* BitDelayAudioProcessor::createEditor()
 }
 
 //==============================================================================
+//Parameters are saved in ParameterState's compact binary format, see ParameterState.h
 void BitDelayAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    ParameterState::write(*this, destData);
 }
 
+//Restoring doesn't allocate. State this version can't read leaves the parameters as they are.
 void BitDelayAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    ParameterState::read(*this, data, sizeInBytes);
 }
 
 //==============================================================================
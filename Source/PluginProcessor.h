@@ -9,27 +9,70 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CompactDelayLine.h"
+#include "DecimationFilter.h"
+#include "DelayCapture.h"
+#include "Decimator.h"
+#include "DelayEnergyTracker.h"
+#include "DelayInterpolation.h"
+#include "DelayLine.h"
+#include "DspStats.h"
+#include "FeedbackKernel.h"
+#include "InterleavedDelay.h"
+#include "MultiTap.h"
+#include "ParameterSmoother.h"
+#include "ParameterState.h"
+#include "PooledDelayLine.h"
+#include "ScopeFifo.h"
 
 //==============================================================================
 /**
 */
 
+//The value is stored normalised in an atomic, so the message thread and hosts can
+//write it while the audio thread reads it without locks. get() and
+//setValueNotifyingHost() in real units go through the parameter's range.
+//Discrete parameters can name their steps, which is then the text hosts show.
 class Echo_Parameter : public juce::AudioProcessorParameter
 {
 public:
+    Echo_Parameter(const juce::String& parameterName, juce::NormalisableRange<float> valueRange,
+                   float defaultRealValue, float initialRealValue, const juce::StringArray& stepNames = {})
+        : name(parameterName),
+          range(valueRange),
+          valueNames(stepNames),
+          stateId(ParameterState::getParameterId(parameterName)),
+          defaultValue(range.convertTo0to1(defaultRealValue)),
+          currentValue(range.convertTo0to1(initialRealValue))
+    {
+    }
+
+    const juce::String name;
+    const juce::NormalisableRange<float> range;
+    const juce::StringArray valueNames;
+    //Identifies the parameter in saved state, so the name must never change
+    const juce::uint32 stateId;
 
-    float defaultValue{ 0 };
-    float currentValue{ 0 };
-    juce::String name;
+    //Current value in real units (seconds, gain, bits)
+    float get() const
+    {
+        return range.convertFrom0to1(currentValue.load(std::memory_order_relaxed));
+    }
+
+    //Sets a value in real units and tells the host about it
+    void setRealValueNotifyingHost(float realValue)
+    {
+        setValueNotifyingHost(range.convertTo0to1(range.snapToLegalValue(realValue)));
+    }
 
     float getValue() const override
     {
-        return currentValue;
+        return currentValue.load(std::memory_order_relaxed);
     }
 
     void setValue(float newValue) override
     {
-        currentValue = newValue;
+        currentValue.store(juce::jlimit(0.0f, 1.0f, newValue), std::memory_order_relaxed);
     }
 
     float getDefaultValue() const override
@@ -39,18 +82,50 @@ public:
 
     juce::String getName(int maximumStringLength) const override
     {
-        return name;
+        return name.substring(0, maximumStringLength);
     }
 
     juce::String getLabel() const override
     {
-        return getName(10);
+        return {};
+    }
+
+    int getNumSteps() const override
+    {
+        if (range.interval > 0.0f)
+            return (int)((range.end - range.start) / range.interval) + 1;
+
+        return juce::AudioProcessorParameter::getNumSteps();
+    }
+
+    bool isDiscrete() const override
+    {
+        return range.interval > 0.0f;
+    }
+
+    juce::String getText(float normalisedValue, int maximumStringLength) const override
+    {
+        auto realValue = range.convertFrom0to1(normalisedValue);
+
+        if (! valueNames.isEmpty())
+            return valueNames[juce::roundToInt((realValue - range.start) / range.interval)].substring(0, maximumStringLength);
+
+        auto text = isDiscrete() ? juce::String(juce::roundToInt(realValue)) : juce::String(realValue, 2);
+        return text.substring(0, maximumStringLength);
     }
 
     float getValueForText(const juce::String& text) const override
     {
-        return 1;
+        const int step = valueNames.indexOf(text.trim(), true);
+        if (step >= 0)
+            return range.convertTo0to1(range.start + (float)step * range.interval);
+
+        return range.convertTo0to1(range.snapToLegalValue(text.getFloatValue()));
     }
+
+private:
+    const float defaultValue;
+    std::atomic<float> currentValue;
 };
 
 class BitDelayAudioProcessor : public juce::AudioProcessor
@@ -60,6 +135,10 @@ class BitDelayAudioProcessor : public juce::AudioProcessor
     Echo_Parameter* regen;
     Echo_Parameter* dry;
     Echo_Parameter* wet;
+    Echo_Parameter* bitDepth;
+    Echo_Parameter* interpolation;
+    Echo_Parameter* maxTime;
+    Echo_Parameter* decimation;
 public:
     //==============================================================================
     BitDelayAudioProcessor();
@@ -74,6 +153,8 @@ public:
 #endif
 
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -103,13 +184,164 @@ public:
     void readFromBuffer(int channel, int bufferLength, int delayBufferLength, juce::AudioBuffer<float>& buffer);
     void decimate(float* channelData, int bitDepth, int rateDivide, int i);
     float derivateSampleRate(double masterSampleRate);
+    static float derivateSampleRate(double masterSampleRate, float delayTime);
+    int getDelayBufferLength() const { return getDelayMask() + 1; }
+
+    //How channels are processed: one at a time, or packed into SIMD lanes by
+    //InterleavedDelay. automatic packs them once there are enough channels to
+    //fill a register. Takes effect on the next prepareToPlay.
+    enum class ChannelProcessing { automatic, perChannel, interleaved };
+    void setChannelProcessing(ChannelProcessing mode) { mChannelProcessing = mode; }
+
+    //How the delay line is stored: floats at the host rate, CompactDelayLine's
+    //16-bit held samples, or a PooledDelayLine that follows Max Time while playing.
+    //full and compact are sized for Max Time in prepareToPlay. Compact and pooled
+    //storage always run the per-channel engine; compact adds a little hold and
+    //quantisation to the feedback path. Takes effect on the next prepareToPlay.
+    enum class DelayStorage { full, compact, pooled };
+    void setDelayStorage(DelayStorage storage) { mDelayStorage = storage; }
+
+    //The per-channel engine on float storage runs FeedbackKernel, one fused pass
+    //per channel. Turning it off runs the blockwise stages instead, for comparison.
+    //Takes effect on the next prepareToPlay.
+    void setFusedFeedback(bool shouldFuse) { mFusedFeedback = shouldFuse; }
+
+    //Interpolation used for the delay tap, from the Interpolation parameter
+    DelayInterpolation::Mode getInterpolation() const { return (DelayInterpolation::Mode)juce::roundToInt(interpolation->get()); }
+
+    //Plain or band-limited sample-and-hold, from the Decimation parameter
+    DecimationFilter::Mode getDecimationMode() const { return (DecimationFilter::Mode)juce::roundToInt(decimation->get()); }
+
+    //The main parameters in the order the constructor adds them
+    enum MainParameter { mainTime, mainVolume, mainRegen, mainDry, mainWet, mainBitDepth, mainInterpolation, mainMaxTime,
+                         mainDecimation, numMainParameters };
+    Echo_Parameter* getMainParameter(MainParameter which) const { return getEchoParameter(which); }
+
+    //The extra taps' parameters follow Decimation, time, level and pan for each tap
+    static constexpr int firstTapParameter = numMainParameters;
+    enum TapParameter { tapTime, tapLevel, tapPan, numTapParameters };
+    Echo_Parameter* getTapParameter(int tap, TapParameter which) const { return getEchoParameter(firstTapParameter + tap * numTapParameters + which); }
+    MultiTap::TapSettings getTapSettings() const;
+
+    //How far back input still reaches the output: the longest tap's delay, on top of the
+    //repeats it takes the feedback to fall below the silence threshold, and the clean
+    //decimation filter's length. Offline renders that start partway into a file run this
+    //much of the input before it to rebuild the delay line.
+    double getPreRollSeconds() const;
+
+    //True while input and delay line are silent and processBlock only applies the dry gain
+    bool isSleeping() const { return mSleeping.load(std::memory_order_relaxed); }
+
+    //The first channel's wet signal and delay line input, for the editor's scope
+    ScopeFifo& getScopeFifo() { return mScopeFifo; }
+
+    //Every channel's wet signal and delay line input, printed to disk while a capture runs
+    DelayCapture& getDelayCapture() { return mDelayCapture; }
+
+    //What processBlock costs, for the editor and the offline tools
+    DspStats& getDspStats() { return mDspStats; }
+
+    //End of the Time parameter's range, also Max Time's lowest and default value
+    static constexpr float timeRangeEnd = 1.7f;
+
+    //The Time knob's range is stretched over 0..Max Time
+    static constexpr float maxTimeLimit = 60.0f;
+
+    //Host blocks are processed in chunks of at most this many frames, so a chunk's
+    //scratch buffers, parameter ramps and slice of the host buffer stay in L1/L2
+    //whatever block size the host uses. Chunks are also where the rate divide, tap
+    //activity and sleep are decided, so the output doesn't depend on the host's
+    //block size either.
+    static constexpr int maxChunkSize = 256;
+
+    //Longest chunk for the current prepareToPlay, the smaller of the block size and maxChunkSize
+    int getMaxChunkSize() const { return mMaxChunkSize; }
+
+    //Ramp lengths of the per-sample parameter smoothing
+    static constexpr double timeSmoothingSeconds = 0.05;
+    static constexpr double gainSmoothingSeconds = 0.02;
+
+    Echo_Parameter* getEchoParameter(int index) const { return static_cast<Echo_Parameter*>(getParameters()[index]); }
 private:
+    //Both processBlock overloads end up here. The delay line, the decimator and the
+    //wet signal stay float (the input is crushed to 16 bits or fewer); the dry
+    //signal and the output keep the host's sample type.
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+    template <typename SampleType>
+    void processChunk(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples);
+    template <typename SampleType>
+    float processSpan(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, int rateDivide);
+    int getMaxBlockwiseSpan() const;
+    template <typename SampleType>
+    void processSilentChunk(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples);
+    template <typename SampleType>
+    bool isInputSilent(const juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples) const;
+    void updateSmoothedParameters(int bufferLength);
+    void decimateChannel(int channel, float* channelData, int numSamples, int rateDivide);
+    template <typename SampleType>
+    void addTaps(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const float* wetGains);
+    template <typename SampleType>
+    void pushToScope(const SampleType* output, const float* dryGains, int numSamples);
+    template <typename SampleType>
+    void pushToCapture(const juce::AudioBuffer<SampleType>& buffer, int startSample, const float* dryGains, int numSamples);
+    void readWrittenFrames(int channel, float* dest, int numSamples) const;
+    DelayInterpolation::TapPositions getTapPositions() const;
+    template <typename Storage>
+    void readExpandedTaps(const Storage& storage, int channel, const DelayInterpolation::TapPositions& taps,
+                          float* dest, int numSamples, float* allpassState);
+    int getDelayMask() const;
+    int getRequiredDelayLength(float maxTimeSeconds) const;
+    void updateDelayScale();
+
     //==============================================================================
-    juce::AudioBuffer<float> mDelayBuffer;
+    DelayLine mDelayLine;
+    CompactDelayLine mCompactDelayLine;
+    PooledDelayLine mPooledDelayLine;
+    DelayStorage mDelayStorage{ DelayStorage::full };
+    DelayStorage mActiveStorage{ DelayStorage::full };
+    //Delay samples per knob second and sample rate, see updateDelayScale
+    double mDelayScale{ 1.0 };
+    std::vector<float> mExpandBuffer;
+    //Scratch buffers are sized in prepareToPlay so the audio thread never allocates
+    juce::AudioBuffer<float> mWetBuffer;
+    juce::AudioBuffer<float> mDecimatedBuffer;
+    juce::AudioBuffer<float> mTapBuffer;
+    int mMaxChunkSize{ 0 };
+    Decimator mDecimator;
+    DecimationFilter mDecimationFilter;
+    DecimationFilter::Mode mDecimationMode{ DecimationFilter::Mode::hold };
+    InterleavedDelay mInterleavedDelay;
+    ChannelProcessing mChannelProcessing{ ChannelProcessing::automatic };
+    bool mUseInterleavedDelay{ false };
+    bool mFusedFeedback{ true };
+    bool mUseFusedFeedback{ false };
     int mWritePosition{ 0 };
     float lastInputGain = 0.0f;
-    float lastFeedbackGain = 0.0f;
-    float lastWetGain = 0.0f;
-    float lastDryGain = 0.0f;
+    DelayEnergyTracker mEnergyTracker;
+    std::atomic<bool> mSleeping{ false };
+    MultiTap mMultiTap;
+    std::vector<float> mTapSum;
+    ScopeFifo mScopeFifo;
+    //The first channel's input, wet signal and delay line input while the scope is open
+    enum ScopeIndex { scopeInputIndex, scopeWetIndex, scopeLineIndex, numScopeSignals };
+    juce::AudioBuffer<float> mScopeBuffer;
+    DelayCapture mDelayCapture;
+    //Every channel's input (then wet signal), followed by every channel's delay line input
+    juce::AudioBuffer<float> mCaptureBuffer;
+    DspStats mDspStats;
+
+    //Per-sample parameter values for the current chunk, one channel each
+    enum SmoothedIndex { timeIndex, feedbackIndex, dryIndex, wetIndex, numSmoothedParameters };
+    juce::AudioBuffer<float> mSmoothedValues;
+    std::vector<int> mReadIndices;
+    std::vector<float> mReadFractions;
+    bool mTimeIsSmoothing{ false };
+    DelayInterpolation::Mode mInterpolation{ DelayInterpolation::Mode::linear };
+    std::vector<float> mAllpassStates;
+    ParameterSmoother mTimeSmoother;
+    ParameterSmoother mRegenSmoother;
+    ParameterSmoother mDrySmoother;
+    ParameterSmoother mWetSmoother;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BitDelayAudioProcessor)
 };
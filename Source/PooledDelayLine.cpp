@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    PooledDelayLine.cpp
+
+  ==============================================================================
+*/
+
+#include "PooledDelayLine.h"
+
+namespace
+{
+    constexpr int chunkLength = DelayChunkPool::chunkLength;
+    constexpr int chunkMask = chunkLength - 1;
+    constexpr int chunkShift = DelayChunkPool::chunkShift;
+
+    //Single-producer single-consumer transfer of chunk pointers
+    int push(juce::AbstractFifo& fifo, std::vector<float*>& storage, float* const* chunks, int numChunks)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numChunks, start1, size1, start2, size2);
+        std::copy(chunks, chunks + size1, storage.begin() + start1);
+        std::copy(chunks + size1, chunks + size1 + size2, storage.begin() + start2);
+        fifo.finishedWrite(size1 + size2);
+        return size1 + size2;
+    }
+
+    int pop(juce::AbstractFifo& fifo, const std::vector<float*>& storage, float** chunks, int numChunks)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numChunks, start1, size1, start2, size2);
+        std::copy(storage.begin() + start1, storage.begin() + start1 + size1, chunks);
+        std::copy(storage.begin() + start2, storage.begin() + start2 + size2, chunks + size1);
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+}
+
+PooledDelayLine::PooledDelayLine()
+{
+}
+
+PooledDelayLine::~PooledDelayLine()
+{
+    mPool->removeClient(this);
+    releaseAllChunks();
+}
+
+int PooledDelayLine::getNumChunksFor(int numFrames)
+{
+    //One chunk more than the frames need, that one is cut open by the write position
+    return juce::jmax(2, juce::nextPowerOfTwo((numFrames + chunkLength - 1) / chunkLength + 1));
+}
+
+void PooledDelayLine::prepare(int numChannels, int initialLength, int maximumLength)
+{
+    mPool->removeClient(this);
+    releaseAllChunks();
+
+    mNumChannels = juce::jmax(0, numChannels);
+    mMaxChunks = getNumChunksFor(juce::jmax(initialLength, maximumLength));
+    mNumChunks = getNumChunksFor(initialLength);
+    mCommittedChunks = mNumChunks;
+    mTargetChunks = mNumChunks;
+
+    mChunks.assign((size_t)mNumChannels * (size_t)mMaxChunks, nullptr);
+    mScratchRow.assign((size_t)mMaxChunks, nullptr);
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+        for (int chunk = 0; chunk < mNumChunks; ++chunk)
+            mChunks[(size_t)(channel * mMaxChunks + chunk)] = mPool->acquire();
+
+    //Enough room for the largest step either way, half the line per channel
+    const int fifoSize = mNumChannels * mMaxChunks + 1;
+    mIncomingFifo.setTotalSize(fifoSize);
+    mOutgoingFifo.setTotalSize(fifoSize);
+    mIncoming.assign((size_t)fifoSize, nullptr);
+    mOutgoing.assign((size_t)fifoSize, nullptr);
+
+    if (mNumChannels > 0)
+        mPool->addClient(this);
+}
+
+void PooledDelayLine::releaseAllChunks()
+{
+    for (auto*& chunk : mChunks)
+    {
+        if (chunk != nullptr)
+            mPool->release(chunk);
+
+        chunk = nullptr;
+    }
+
+    float* chunk = nullptr;
+
+    while (pop(mIncomingFifo, mIncoming, &chunk, 1) == 1)
+        mPool->release(chunk);
+
+    while (pop(mOutgoingFifo, mOutgoing, &chunk, 1) == 1)
+        mPool->release(chunk);
+}
+
+void PooledDelayLine::setRequiredLength(int numFrames)
+{
+    mTargetChunks.store(juce::jmin(mMaxChunks, getNumChunksFor(numFrames)), std::memory_order_relaxed);
+}
+
+int PooledDelayLine::useTimeSlice()
+{
+    //Give back what the audio thread dropped
+    float* chunk = nullptr;
+
+    while (pop(mOutgoingFifo, mOutgoing, &chunk, 1) == 1)
+        mPool->release(chunk);
+
+    //Queue enough chunks for the audio thread to double its way up to the target
+    //Queued chunks are counted before the committed size, so a resize in between can
+    //only make this undershoot, and the next slice tops up
+    const int queued = mIncomingFifo.getNumReady();
+    const int committed = mCommittedChunks.load();
+    const int target = mTargetChunks.load(std::memory_order_relaxed);
+    const int missing = (target - committed) * mNumChannels - queued;
+
+    for (int i = 0; i < juce::jmin(missing, mIncomingFifo.getFreeSpace()); ++i)
+    {
+        chunk = mPool->acquire();
+        push(mIncomingFifo, mIncoming, &chunk, 1);
+    }
+
+    return 20;
+}
+
+void PooledDelayLine::update(int& writePosition)
+{
+    const int target = mTargetChunks.load(std::memory_order_relaxed);
+
+    while (mNumChunks < target && mIncomingFifo.getNumReady() >= mNumChunks * mNumChannels)
+        grow(writePosition);
+
+    while (mNumChunks > target && mNumChunks > 2 && mOutgoingFifo.getFreeSpace() >= mNumChunks / 2 * mNumChannels)
+        shrink(writePosition);
+
+    mCommittedChunks.store(mNumChunks);
+}
+
+//Doubles the line: the new chunks go in right after the one being written
+void PooledDelayLine::grow(int writePosition)
+{
+    const int current = (writePosition & getMask()) >> chunkShift;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        auto* row = mChunks.data() + channel * mMaxChunks;
+        std::copy_backward(row + current + 1, row + mNumChunks, row + 2 * mNumChunks);
+        pop(mIncomingFifo, mIncoming, row + current + 1, mNumChunks);
+    }
+
+    mNumChunks *= 2;
+}
+
+//Halves the line by dropping the chunks right after the one being written, the
+//rest is rotated so it ends with the current chunk
+void PooledDelayLine::shrink(int& writePosition)
+{
+    const int current = (writePosition & getMask()) >> chunkShift;
+    const int half = mNumChunks / 2;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        auto* row = mChunks.data() + channel * mMaxChunks;
+
+        for (int i = 0; i < half; ++i)
+            mScratchRow[(size_t)i] = row[(current + 1 + i) % mNumChunks];
+
+        push(mOutgoingFifo, mOutgoing, mScratchRow.data(), half);
+
+        for (int i = 0; i < half; ++i)
+            mScratchRow[(size_t)i] = row[(current + 1 + half + i) % mNumChunks];
+
+        std::copy(mScratchRow.begin(), mScratchRow.begin() + half, row);
+        std::fill(row + half, row + mNumChunks, nullptr);
+    }
+
+    mNumChunks = half;
+    writePosition = ((half - 1) << chunkShift) + (writePosition & chunkMask);
+}
+
+void PooledDelayLine::write(int channel, int position, const float* source, int numSamples)
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    auto* const* row = mChunks.data() + channel * mMaxChunks;
+
+    while (numSamples > 0)
+    {
+        position = wrap(position);
+        const int offset = position & chunkMask;
+        const int numToCopy = juce::jmin(numSamples, chunkLength - offset);
+
+        juce::FloatVectorOperations::copy(row[position >> chunkShift] + offset, source, numToCopy);
+
+        position += numToCopy;
+        source += numToCopy;
+        numSamples -= numToCopy;
+    }
+}
+
+void PooledDelayLine::read(int channel, int position, float* dest, int numSamples) const
+{
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    auto* const* row = mChunks.data() + channel * mMaxChunks;
+
+    while (numSamples > 0)
+    {
+        position = wrap(position);
+        const int offset = position & chunkMask;
+        const int numToCopy = juce::jmin(numSamples, chunkLength - offset);
+
+        juce::FloatVectorOperations::copy(dest, row[position >> chunkShift] + offset, numToCopy);
+
+        position += numToCopy;
+        dest += numToCopy;
+        numSamples -= numToCopy;
+    }
+}
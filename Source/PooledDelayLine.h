@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    PooledDelayLine.h
+
+    Delay storage for long delays, built from DelayChunkPool chunks. The
+    line always has a power-of-two number of chunks, so positions still
+    wrap with a mask, and it grows or shrinks by doubling or halving while
+    audio runs:
+
+    - setRequiredLength() (any thread) sets how long the line has to be.
+    - The pool's thread takes fresh chunks from the pool and queues them,
+      and returns the chunks the audio thread has dropped.
+    - update() (audio thread, once per block) doubles the line when enough
+      chunks are queued, or halves it when the outgoing queue has room.
+      That is pointer shuffling only, it never allocates or locks.
+
+    New chunks go in, and dropped chunks come out, right after the write
+    position, where the oldest audio is. The last (chunks - 1) * chunkLength
+    frames behind the write position survive a resize; getMaximumDelay()
+    is that length.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayChunkPool.h"
+#include <vector>
+
+class PooledDelayLine : private juce::TimeSliceClient
+{
+public:
+    PooledDelayLine();
+    ~PooledDelayLine() override;
+
+    //Message thread, not while processing. Takes the chunks for initialLength
+    //straight from the pool, the line can later grow up to maximumLength.
+    void prepare(int numChannels, int initialLength, int maximumLength);
+
+    //Any thread. The line follows in the background.
+    void setRequiredLength(int numFrames);
+
+    //Audio thread, before any access in a block. Applies queued resizes and
+    //moves writePosition along so it still points at the same audio.
+    void update(int& writePosition);
+
+    int getLength() const           { return mNumChunks << DelayChunkPool::chunkShift; }
+    int getMask() const             { return getLength() - 1; }
+    int wrap(int position) const    { return position & getMask(); }
+    int getMaximumDelay() const     { return (mNumChunks - 1) << DelayChunkPool::chunkShift; }
+
+    void write(int channel, int position, const float* source, int numSamples);
+    void read(int channel, int position, float* dest, int numSamples) const;
+
+private:
+    int useTimeSlice() override;
+
+    static int getNumChunksFor(int numFrames);
+    void releaseAllChunks();
+    void grow(int writePosition);
+    void shrink(int& writePosition);
+
+    juce::SharedResourcePointer<DelayChunkPool> mPool;
+
+    int mNumChannels{ 0 };
+    int mMaxChunks{ 0 };
+    int mNumChunks{ 0 };                        //audio thread
+    std::atomic<int> mCommittedChunks{ 0 };     //mNumChunks as seen by the pool's thread
+    std::atomic<int> mTargetChunks{ 0 };
+
+    std::vector<float*> mChunks;        //[channel][mMaxChunks], first mNumChunks in use
+    std::vector<float*> mScratchRow;
+
+    //Fresh chunks on their way in, dropped chunks on their way out
+    juce::AbstractFifo mIncomingFifo{ 1 };
+    juce::AbstractFifo mOutgoingFifo{ 1 };
+    std::vector<float*> mIncoming;
+    std::vector<float*> mOutgoing;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PooledDelayLine)
+};
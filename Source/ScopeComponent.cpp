@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ScopeComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "ScopeComponent.h"
+
+ScopeComponent::ScopeComponent(ScopeFifo& fifo)
+    : mFifo(fifo),
+      mIncoming(ScopeFifo::capacity)
+{
+    setOpaque(true);
+    mFifo.setActive(true);
+    startTimerHz(frameRate);
+}
+
+ScopeComponent::~ScopeComponent()
+{
+    stopTimer();
+    mFifo.setActive(false);
+}
+
+void ScopeComponent::resized()
+{
+    mHistory.assign((size_t)juce::jmax(1, getWidth()), ScopeFifo::Bucket());
+    mNewest = 0;
+}
+
+void ScopeComponent::timerCallback()
+{
+    const int numNew = mFifo.pop(mIncoming.data(), (int)mIncoming.size());
+
+    if (numNew == 0 || mHistory.empty())
+        return;
+
+    //Only the newest buckets that fit on screen matter
+    const int numColumns = (int)mHistory.size();
+    for (int i = juce::jmax(0, numNew - numColumns); i < numNew; ++i)
+    {
+        mNewest = (mNewest + 1) % numColumns;
+        mHistory[(size_t)mNewest] = mIncoming[(size_t)i];
+    }
+
+    repaint();
+}
+
+void ScopeComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+
+    const int numColumns = (int)mHistory.size();
+    const float centre = (float)getHeight() * 0.5f;
+    const float halfHeight = (float)getHeight() * 0.5f;
+
+    auto toY = [=](float value) { return centre - juce::jlimit(-1.0f, 1.0f, value) * halfHeight; };
+
+    //Oldest column on the left, one vertical line per bucket and signal
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const auto& bucket = mHistory[(size_t)((mNewest + 1 + column) % numColumns)];
+
+        g.setColour(juce::Colours::darkred);
+        g.drawVerticalLine(column, toY(bucket.lineMax), toY(bucket.lineMin) + 1.0f);
+        g.setColour(juce::Colours::white);
+        g.drawVerticalLine(column, toY(bucket.wetMax), toY(bucket.wetMin) + 1.0f);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    ScopeComponent.h
+
+    Scrolling min/max view of the first channel's wet signal (white) over
+    what goes into its delay line (dark red). Reads ScopeFifo on a timer
+    capped at frameRate and repaints only when new buckets arrived, so the
+    audio thread never waits for the UI and an idle plugin costs no paints.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ScopeFifo.h"
+#include <vector>
+
+class ScopeComponent : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int frameRate = 30;
+
+    //Switches the FIFO on for as long as the scope exists
+    explicit ScopeComponent(ScopeFifo& fifo);
+    ~ScopeComponent() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+
+    ScopeFifo& mFifo;
+
+    //One bucket per pixel column, mHistory[mNewest] is the newest
+    std::vector<ScopeFifo::Bucket> mHistory;
+    int mNewest{ 0 };
+    std::vector<ScopeFifo::Bucket> mIncoming;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScopeComponent)
+};
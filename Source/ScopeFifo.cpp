@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    ScopeFifo.cpp
+
+  ==============================================================================
+*/
+
+#include "ScopeFifo.h"
+
+void ScopeFifo::push(const float* wet, const float* line, int numSamples)
+{
+    if (! isActive())
+        return;
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        const int count = juce::jmin(samplesPerBucket - mPendingSamples, numSamples - i);
+        const auto wetRange = juce::FloatVectorOperations::findMinAndMax(wet + i, count);
+        const auto lineRange = juce::FloatVectorOperations::findMinAndMax(line + i, count);
+
+        if (mPendingSamples == 0)
+        {
+            mPending = { wetRange.getStart(), wetRange.getEnd(), lineRange.getStart(), lineRange.getEnd() };
+        }
+        else
+        {
+            mPending.wetMin = juce::jmin(mPending.wetMin, wetRange.getStart());
+            mPending.wetMax = juce::jmax(mPending.wetMax, wetRange.getEnd());
+            mPending.lineMin = juce::jmin(mPending.lineMin, lineRange.getStart());
+            mPending.lineMax = juce::jmax(mPending.lineMax, lineRange.getEnd());
+        }
+
+        mPendingSamples += count;
+        i += count;
+
+        if (mPendingSamples == samplesPerBucket)
+            finishBucket();
+    }
+}
+
+void ScopeFifo::pushSilence(int numSamples)
+{
+    if (! isActive())
+        return;
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        const int count = juce::jmin(samplesPerBucket - mPendingSamples, numSamples - i);
+
+        if (mPendingSamples == 0)
+        {
+            mPending = {};
+        }
+        else
+        {
+            mPending.wetMin = juce::jmin(mPending.wetMin, 0.0f);
+            mPending.wetMax = juce::jmax(mPending.wetMax, 0.0f);
+            mPending.lineMin = juce::jmin(mPending.lineMin, 0.0f);
+            mPending.lineMax = juce::jmax(mPending.lineMax, 0.0f);
+        }
+
+        mPendingSamples += count;
+        i += count;
+
+        if (mPendingSamples == samplesPerBucket)
+            finishBucket();
+    }
+}
+
+void ScopeFifo::finishBucket()
+{
+    int start1, size1, start2, size2;
+    mFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        mBuckets[(size_t)start1] = mPending;
+
+    mFifo.finishedWrite(size1);
+    mPendingSamples = 0;
+}
+
+int ScopeFifo::pop(Bucket* dest, int maxBuckets)
+{
+    int start1, size1, start2, size2;
+    mFifo.prepareToRead(maxBuckets, start1, size1, start2, size2);
+    std::copy(mBuckets.begin() + start1, mBuckets.begin() + start1 + size1, dest);
+    std::copy(mBuckets.begin() + start2, mBuckets.begin() + start2 + size2, dest + size1);
+    mFifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    ScopeFifo.h
+
+    Hands the scope's data from the audio thread to the editor. The audio
+    thread folds every samplesPerBucket samples of the wet signal and of
+    what is written into the delay line into min/max buckets and pushes
+    them through a juce::AbstractFifo, which is wait-free for one writer
+    and one reader. A full FIFO drops buckets rather than waiting, and
+    nothing at all is done while no scope is open.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+class ScopeFifo
+{
+public:
+    static constexpr int samplesPerBucket = 64;
+    static constexpr int capacity = 4096;   //buckets, about 5 s at 48 kHz
+
+    struct Bucket
+    {
+        float wetMin{ 0.0f };
+        float wetMax{ 0.0f };
+        float lineMin{ 0.0f };
+        float lineMax{ 0.0f };
+    };
+
+    //Set by the scope while it is showing, push() does nothing otherwise
+    void setActive(bool shouldBeActive) { mActive.store(shouldBeActive, std::memory_order_relaxed); }
+    bool isActive() const { return mActive.load(std::memory_order_relaxed); }
+
+    //Audio thread: numSamples of the wet signal and of the frames written into the delay line
+    void push(const float* wet, const float* line, int numSamples);
+
+    //Audio thread: numSamples of silence, for blocks where the delay line is asleep
+    void pushSilence(int numSamples);
+
+    //Editor: moves up to maxBuckets of the oldest buckets into dest, returns how many
+    int pop(Bucket* dest, int maxBuckets);
+
+private:
+    void finishBucket();
+
+    std::atomic<bool> mActive{ false };
+    juce::AbstractFifo mFifo{ capacity };
+    std::array<Bucket, capacity> mBuckets;
+
+    //The bucket being filled, audio thread only
+    Bucket mPending;
+    int mPendingSamples{ 0 };
+};
@@ -0,0 +1,1416 @@
+/*
+  ==============================================================================
+
+    BitDelayBench
+
+    Microbenchmarks for BitDelayAudioProcessor. Measures ns/sample of
+    processBlock and its helpers over a grid of block sizes, sample rates,
+    channel counts, delay times, channel processing modes and delay
+    storage, and writes the results as CSV or JSON so runs can be diffed
+    against each other. A second grid compares the delay interpolation
+    modes, with a steady delay time and with one that keeps sweeping
+    (every tap at its own fractional position).
+    "processBlock (idle)" is the cost once input and delay line are silent.
+    perChannel runs the fused feedback kernel, perChannelBlockwise the
+    separate stages it replaced, on the same grid. Another grid compares
+    the decimation modes at a short and a long delay time (small and large
+    rate divide), to show that the clean modes cost the same per sample
+    whatever the rate divide. The taps grid times 1, 4 and 8 extra taps
+    (MultiTap) on top of the main one. The bank grid times BitDelayBank
+    over voices x worker threads, next to one mono processor per voice
+    (numChannels is the voice count there).
+    Before timing anything, the plugin state is saved and restored once.
+    The run fails if any parameter comes back different, or (in Debug
+    builds) if restoring allocates. The get/setStateInformation rows give
+    ns per call instead of per sample. BitDelayBank is also rendered
+    against one mono processor per voice and has to match it,
+    Decimator's quantizing has to match the original fmodf form, and
+    interpolation None has to read the frame the original plugin read.
+
+    In Debug builds every processBlock call here and in --fuzz runs
+    inside an AllocationGuard scope, and the run fails if one allocates.
+    A separate pass runs every engine and decimation mode with all taps
+    and a capture on, while Max Time makes a pooled line grow and shrink.
+
+    BitDelayBench [--format csv|json] [--output file] [--quick]
+        --quick     smaller grid for a fast sanity run
+
+    BitDelayBench --fuzz [--cases n] [--seed n] [--quick]
+        Differential fuzzing instead of timing. Each case is a random
+        session (sample rate, block size, channel count, a script of host
+        blocks of odd sizes, some longer than the delay line, parameter
+        changes that favour the ends of their ranges, and input from
+        silence to full scale) run through every engine, in single and
+        double precision. The output has to match ReferenceModel within
+        1e-4, or the fused engine for the clean decimation modes. Fails
+        with the case and sample that differ; the same seed replays the
+        same cases. Decimator's quantizing is checked bit for bit against
+        the original fmodf form first, for every bit depth, and None's read
+        index against the original plugin's.
+
+    Each case is timed as the best of several repeats, each one long enough
+    to swamp timer resolution. ns/sample is per channel sample.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/AllocationGuard.h"
+#include "../../../Source/BitDelayBank.h"
+#include "../../../Source/PluginProcessor.h"
+#include "ReferenceModel.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    struct BenchCase
+    {
+        double sampleRate;
+        int blockSize;
+        int numChannels;
+        float time;
+        BitDelayAudioProcessor::ChannelProcessing channelProcessing;
+        DelayInterpolation::Mode interpolation;
+        bool sweep;     //time parameter changes on every call, so the time smoother never settles
+        BitDelayAudioProcessor::DelayStorage storage;
+        bool fused = true;
+        DecimationFilter::Mode decimation = DecimationFilter::Mode::hold;
+        int numTaps = 0;    //extra taps switched on, see MultiTap
+        int numThreads = 1; //BitDelayBank workers, numChannels is its voice count
+    };
+
+    struct BenchResult
+    {
+        juce::String function;
+        BenchCase benchCase;
+        double nsPerSample;
+    };
+
+    //Runs fn until at least minSeconds have passed, repeats that a few times and
+    //keeps the fastest run, which is the one least disturbed by the OS
+    template <typename Function>
+    double measureNsPerSample(Function&& fn, int samplesPerCall)
+    {
+        constexpr double minSeconds = 0.02;
+        constexpr int numRepeats = 5;
+
+        for (int i = 0; i < 16; ++i)
+            fn();
+
+        double best = std::numeric_limits<double>::max();
+
+        for (int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            juce::int64 numCalls = 0;
+            const auto start = juce::Time::getHighResolutionTicks();
+            double elapsed = 0.0;
+
+            do
+            {
+                for (int i = 0; i < 32; ++i)
+                    fn();
+
+                numCalls += 32;
+                elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            } while (elapsed < minSeconds);
+
+            best = juce::jmin(best, elapsed * 1.0e9 / ((double)numCalls * samplesPerCall));
+        }
+
+        return best;
+    }
+
+    void setParameter(juce::AudioProcessor& processor, const juce::String& name, float value)
+    {
+        for (auto* parameter : processor.getParameters())
+            if (parameter->getName(100).equalsIgnoreCase(name))
+                parameter->setValue(parameter->getValueForText(juce::String(value)));
+    }
+
+    void fillWithNoise(juce::AudioBuffer<float>& buffer)
+    {
+        juce::Random random(0x5eed);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+
+    //processBlock marked as realtime, so that in builds with BITDELAY_ALLOCATION_GUARD
+    //any allocation it makes is counted
+    template <typename SampleType>
+    void processGuarded(BitDelayAudioProcessor& processor, juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midi)
+    {
+        AllocationGuard::ScopedNoAllocation noAllocation;
+        processor.processBlock(buffer, midi);
+    }
+
+    //Fails the run if a guarded scope allocated since the violations were last reset
+    void expectNoAllocation(const juce::String& what)
+    {
+        if (AllocationGuard::getNumViolations() > 0)
+            juce::ConsoleApplication::fail("BitDelayBench: " + what + " allocated on the audio thread");
+    }
+
+    void runCase(const BenchCase& c, juce::Array<BenchResult>& results)
+    {
+        BitDelayAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+
+        if (! processor.setBusesLayout(layout))
+            return;
+
+        processor.setChannelProcessing(c.channelProcessing);
+        processor.setDelayStorage(c.storage);
+        processor.setFusedFeedback(c.fused);
+        setParameter(processor, "Time", c.time);
+        setParameter(processor, "Interpolation", (float)c.interpolation);
+        setParameter(processor, "Decimation", (float)c.decimation);
+
+        for (int tap = 0; tap < c.numTaps; ++tap)
+            processor.getTapParameter(tap, BitDelayAudioProcessor::tapLevel)->setRealValueNotifyingHost(0.5f);
+
+        processor.setRateAndBufferSizeDetails(c.sampleRate, c.blockSize);
+        processor.prepareToPlay(c.sampleRate, c.blockSize);
+
+        juce::AudioBuffer<float> input(c.numChannels, c.blockSize);
+        juce::AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+        juce::MidiBuffer midi;
+        fillWithNoise(input);
+
+        const int samplesPerCall = c.blockSize * c.numChannels;
+        const int delayBufferLength = processor.getDelayBufferLength();
+        const int rateDivide = (int)processor.derivateSampleRate(c.sampleRate);
+        //The processor's stages work on one chunk at a time, its scratch holds no more
+        const int chunkSize = processor.getMaxChunkSize();
+
+        auto add = [&](const juce::String& function, double nsPerSample)
+        {
+            results.add({ function, c, nsPerSample });
+        };
+
+        auto* timeParameter = processor.getMainParameter(BitDelayAudioProcessor::mainTime);
+        const float sweepValues[] = { timeParameter->range.convertTo0to1(c.time),
+                                      timeParameter->range.convertTo0to1(c.time * 0.9f) };
+        int numCalls = 0;
+        AllocationGuard::resetViolations();
+
+        add("processBlock", measureNsPerSample([&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+                buffer.copyFrom(channel, 0, input, channel, 0, c.blockSize);
+
+            if (c.sweep)
+                timeParameter->setValue(sweepValues[++numCalls & 1]);
+
+            processGuarded(processor, buffer, midi);
+        }, samplesPerCall));
+
+        expectNoAllocation("processBlock");
+
+        //Tap cases only time the whole block
+        if (c.numTaps > 0)
+            return;
+
+        //Cost of an idle instance: silent input into a delay line that has decayed
+        if (! c.sweep && c.interpolation == DelayInterpolation::Mode::linear && c.decimation == DecimationFilter::Mode::hold)
+        {
+            juce::AudioBuffer<float> silence(c.numChannels, c.blockSize);
+            const auto decaySamples = processor.getTailLengthSeconds() * c.sampleRate + delayBufferLength;
+
+            for (int i = 0; i < (int)(decaySamples / c.blockSize) + 2 && ! processor.isSleeping(); ++i)
+            {
+                silence.clear();
+                processGuarded(processor, silence, midi);
+            }
+
+            add("processBlock (idle)", measureNsPerSample([&]
+            {
+                silence.clear();
+                processGuarded(processor, silence, midi);
+            }, samplesPerCall));
+
+            expectNoAllocation("processBlock (idle)");
+        }
+
+        //The band-limited hold on its own
+        if (c.decimation != DecimationFilter::Mode::hold)
+        {
+            if (c.channelProcessing == BitDelayAudioProcessor::ChannelProcessing::perChannel)
+            {
+                DecimationFilter filter;
+                filter.prepare(c.numChannels, 1, rateDivide, c.blockSize);
+                std::vector<Decimator::ChannelState> states((size_t)c.numChannels);
+
+                add("DecimationFilter::process", measureNsPerSample([&]
+                {
+                    for (int channel = 0; channel < c.numChannels; ++channel)
+                    {
+                        buffer.copyFrom(channel, 0, input, channel, 0, c.blockSize);
+                        auto& state = states[(size_t)channel];
+                        filter.process<1>(c.decimation, channel, buffer.getWritePointer(channel), c.blockSize,
+                                          &state.heldValue, state.holdCounter, 8, rateDivide);
+                    }
+                }, samplesPerCall));
+            }
+
+            return;
+        }
+
+        //The helpers below work on the per-channel delay buffer only, and the
+        //interpolation grid only looks at the delay read
+        if (c.channelProcessing != BitDelayAudioProcessor::ChannelProcessing::perChannel || ! c.fused)
+            return;
+
+        if (c.sweep || c.interpolation != DelayInterpolation::Mode::linear)
+        {
+            add("readFromBuffer", measureNsPerSample([&]
+            {
+                for (int channel = 0; channel < c.numChannels; ++channel)
+                    for (int start = 0; start < c.blockSize; start += chunkSize)
+                        processor.readFromBuffer(channel, juce::jmin(chunkSize, c.blockSize - start), delayBufferLength, buffer);
+            }, samplesPerCall));
+            return;
+        }
+
+        add("fillBuffer", measureNsPerSample([&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+                for (int start = 0; start < c.blockSize; start += chunkSize)
+                    processor.fillBuffer(channel, juce::jmin(chunkSize, c.blockSize - start), delayBufferLength,
+                                         input.getWritePointer(channel, start));
+        }, samplesPerCall));
+
+        add("readFromBuffer", measureNsPerSample([&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+                for (int start = 0; start < c.blockSize; start += chunkSize)
+                    processor.readFromBuffer(channel, juce::jmin(chunkSize, c.blockSize - start), delayBufferLength, buffer);
+        }, samplesPerCall));
+
+        add("decimate", measureNsPerSample([&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+            {
+                buffer.copyFrom(channel, 0, input, channel, 0, c.blockSize);
+                auto* data = buffer.getWritePointer(channel);
+
+                for (int i = 0; i < c.blockSize; ++i)
+                    processor.decimate(data, 8, rateDivide, i);
+            }
+        }, samplesPerCall));
+
+        Decimator decimator;
+        decimator.prepare(c.numChannels);
+        decimator.setParameters(8, rateDivide);
+
+        add("Decimator::process", measureNsPerSample([&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+            {
+                buffer.copyFrom(channel, 0, input, channel, 0, c.blockSize);
+                decimator.process(channel, buffer.getWritePointer(channel), c.blockSize);
+            }
+        }, samplesPerCall));
+
+        processor.releaseResources();
+    }
+
+    float getRandomRealValue(const Echo_Parameter& parameter, juce::Random& random)
+    {
+        return parameter.range.snapToLegalValue(parameter.range.convertFrom0to1(random.nextFloat()));
+    }
+
+    void expectSameParameters(const BitDelayAudioProcessor& expected, const BitDelayAudioProcessor& actual, const juce::String& what)
+    {
+        for (int i = 0; i < expected.getParameters().size(); ++i)
+        {
+            const auto* parameter = expected.getEchoParameter(i);
+
+            if (std::abs(parameter->get() - actual.getEchoParameter(i)->get()) > 1.0e-5f * parameter->range.getRange().getLength())
+                juce::ConsoleApplication::fail("BitDelayBench: " + what + " changed " + parameter->name);
+        }
+    }
+
+    //Round trip through the binary state, then the cost of saving and restoring it
+    void runStateCase(juce::Array<BenchResult>& results)
+    {
+        BitDelayAudioProcessor source, restored;
+        juce::Random random(0x57a7e);
+
+        for (int i = 0; i < source.getParameters().size(); ++i)
+            source.getEchoParameter(i)->setRealValueNotifyingHost(getRandomRealValue(*source.getEchoParameter(i), random));
+
+        juce::MemoryBlock state;
+        source.getStateInformation(state);
+
+        AllocationGuard::resetViolations();
+        {
+            AllocationGuard::ScopedNoAllocation noAllocation;
+            restored.setStateInformation(state.getData(), (int)state.getSize());
+        }
+
+        if (AllocationGuard::getNumViolations() > 0)
+            juce::ConsoleApplication::fail("BitDelayBench: setStateInformation allocated");
+
+        expectSameParameters(source, restored, "state round trip");
+
+        //A later version with a longer header, longer entries and a parameter this one doesn't have
+        const int numEntries = source.getParameters().size() + 1;
+        juce::MemoryOutputStream future;
+        future.writeInt(0x74734442);
+        future.writeShort((short)(ParameterState::version + 1));
+        future.writeShort(16);
+        future.writeShort((short)numEntries);
+        future.writeShort(12);
+        future.writeInt(0);
+
+        for (int i = 0; i < numEntries; ++i)
+        {
+            const bool unknown = i == 0;
+            future.writeInt(unknown ? (int)ParameterState::getParameterId("Not A Parameter") : (int)source.getEchoParameter(i - 1)->stateId);
+            future.writeFloat(unknown ? 1.0f : source.getEchoParameter(i - 1)->get());
+            future.writeInt(-1);
+        }
+
+        BitDelayAudioProcessor fromFuture;
+        fromFuture.setStateInformation(future.getData(), (int)future.getDataSize());
+        expectSameParameters(source, fromFuture, "newer state version");
+
+        //Corrupt states are rejected whole: entry counts and sizes past the end of the
+        //data (up to 65535 entries of 65535 bytes) and a truncated block
+        auto patch = [](juce::MemoryBlock block, int offset, int value)
+        {
+            auto* bytes = static_cast<juce::uint8*>(block.getData());
+            bytes[offset] = (juce::uint8)(value & 0xff);
+            bytes[offset + 1] = (juce::uint8)((value >> 8) & 0xff);
+            return block;
+        };
+
+        const juce::MemoryBlock malformedStates[] = { patch(state, 8, 0xffff), patch(state, 10, 0xffff), patch(state, 6, 0xffff),
+                                                      patch(patch(state, 8, 0xffff), 10, 0xffff),
+                                                      patch(state, 8, source.getParameters().size() + 1),
+                                                      juce::MemoryBlock(state.getData(), state.getSize() - 1) };
+
+        for (auto& malformed : malformedStates)
+        {
+            BitDelayAudioProcessor fromMalformed;
+            fromMalformed.setStateInformation(state.getData(), (int)state.getSize());
+            fromMalformed.setStateInformation(malformed.getData(), (int)malformed.getSize());
+            expectSameParameters(source, fromMalformed, "malformed state");
+        }
+
+        const BenchCase c{ 0.0, 0, 0, 0.0f, BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                           DelayInterpolation::Mode::linear, false, BitDelayAudioProcessor::DelayStorage::full };
+
+        results.add({ "getStateInformation", c, measureNsPerSample([&] { source.getStateInformation(state); }, 1) });
+        results.add({ "setStateInformation", c, measureNsPerSample([&]
+        {
+            restored.setStateInformation(state.getData(), (int)state.getSize());
+        }, 1) });
+    }
+
+    BitDelayBank::VoiceParameters getVoiceParameters(const BitDelayAudioProcessor& processor)
+    {
+        BitDelayBank::VoiceParameters parameters;
+        parameters.time = processor.getMainParameter(BitDelayAudioProcessor::mainTime)->get();
+        parameters.regen = processor.getMainParameter(BitDelayAudioProcessor::mainRegen)->get();
+        parameters.dry = processor.getMainParameter(BitDelayAudioProcessor::mainDry)->get();
+        parameters.wet = processor.getMainParameter(BitDelayAudioProcessor::mainWet)->get();
+        parameters.bitDepth = juce::roundToInt(processor.getMainParameter(BitDelayAudioProcessor::mainBitDepth)->get());
+        parameters.interpolation = processor.getInterpolation();
+        parameters.decimation = processor.getDecimationMode();
+        return parameters;
+    }
+
+    //BitDelayBank against one mono processor per voice, with parameter changes on the
+    //way, host blocks longer and shorter than a chunk and input that never stays quiet
+    //long enough for a processor to sleep. Voices run on several threads.
+    void runBankCheck()
+    {
+        constexpr int numVoices = 12;
+        constexpr double sampleRate = 48000.0;
+        constexpr int maxBlockSize = 700;
+        juce::Random random(0xba4c);
+
+        BitDelayBank bank;
+        bank.prepare(numVoices, sampleRate, maxBlockSize, 3);
+        std::vector<std::unique_ptr<BitDelayAudioProcessor>> processors;
+
+        auto randomise = [&](BitDelayAudioProcessor& processor)
+        {
+            for (auto which : { BitDelayAudioProcessor::mainTime, BitDelayAudioProcessor::mainRegen, BitDelayAudioProcessor::mainDry,
+                                BitDelayAudioProcessor::mainWet, BitDelayAudioProcessor::mainBitDepth,
+                                BitDelayAudioProcessor::mainInterpolation, BitDelayAudioProcessor::mainDecimation })
+            {
+                auto* parameter = processor.getMainParameter(which);
+                parameter->setRealValueNotifyingHost(getRandomRealValue(*parameter, random));
+            }
+        };
+
+        for (int voice = 0; voice < numVoices; ++voice)
+        {
+            auto processor = std::make_unique<BitDelayAudioProcessor>();
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add(juce::AudioChannelSet::mono());
+            layout.outputBuses.add(juce::AudioChannelSet::mono());
+            processor->setBusesLayout(layout);
+
+            randomise(*processor);
+            bank.setVoiceParameters(voice, getVoiceParameters(*processor));
+            processor->setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+            processor->prepareToPlay(sampleRate, maxBlockSize);
+            processors.push_back(std::move(processor));
+        }
+
+        bank.reset();
+        AllocationGuard::resetViolations();
+
+        juce::AudioBuffer<float> expected(numVoices, maxBlockSize), actual(numVoices, maxBlockSize);
+        juce::MidiBuffer midi;
+        const int blockSizes[] = { maxBlockSize, 100, 37, 256, 1, 513 };
+
+        for (int block = 0; block < 600; ++block)
+        {
+            const int numSamples = blockSizes[block % 6];
+
+            if (block % 100 == 50)
+            {
+                for (int voice = 0; voice < numVoices; ++voice)
+                {
+                    randomise(*processors[(size_t)voice]);
+                    bank.setVoiceParameters(voice, getVoiceParameters(*processors[(size_t)voice]));
+                }
+            }
+
+            const float level = random.nextFloat();
+
+            for (int voice = 0; voice < numVoices; ++voice)
+            {
+                for (int i = 0; i < numSamples; ++i)
+                    expected.setSample(voice, i, level * (random.nextFloat() * 2.0f - 1.0f));
+
+                actual.copyFrom(voice, 0, expected, voice, 0, numSamples);
+
+                juce::AudioBuffer<float> voiceBuffer(expected.getArrayOfWritePointers() + voice, 1, numSamples);
+                processGuarded(*processors[(size_t)voice], voiceBuffer, midi);
+            }
+
+            {
+                AllocationGuard::ScopedNoAllocation noAllocation;
+                bank.process(actual.getArrayOfWritePointers(), numSamples);
+            }
+
+            for (int voice = 0; voice < numVoices; ++voice)
+                for (int i = 0; i < numSamples; ++i)
+                    if (std::abs(expected.getSample(voice, i) - actual.getSample(voice, i)) > 1.0e-6f)
+                        juce::ConsoleApplication::fail("BitDelayBank: voice " + juce::String(voice) + " differs from a mono processor in block "
+                                                       + juce::String(block) + ", sample " + juce::String(i));
+        }
+
+        expectNoAllocation("BitDelayBank or a mono processor");
+    }
+
+    //numVoices bank voices on numThreads threads, and (single threaded) the same voices
+    //as one mono processor each
+    void runBankCase(int numVoices, int numThreads, juce::Array<BenchResult>& results)
+    {
+        BenchCase c{ 48000.0, 256, numVoices, BitDelayBank::maxTime, BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                     DelayInterpolation::Mode::linear, false, BitDelayAudioProcessor::DelayStorage::full };
+        c.numThreads = numThreads;
+
+        juce::AudioBuffer<float> input(numVoices, c.blockSize), buffer(numVoices, c.blockSize);
+        fillWithNoise(input);
+
+        BitDelayBank bank;
+        bank.prepare(numVoices, c.sampleRate, c.blockSize, numThreads);
+        bank.reset();
+        AllocationGuard::resetViolations();
+
+        results.add({ "BitDelayBank::process", c, measureNsPerSample([&]
+        {
+            buffer.makeCopyOf(input, true);
+            AllocationGuard::ScopedNoAllocation noAllocation;
+            bank.process(buffer.getArrayOfWritePointers(), c.blockSize);
+        }, c.blockSize * numVoices) });
+
+        expectNoAllocation("BitDelayBank::process");
+
+        if (numThreads > 1)
+            return;
+
+        std::vector<std::unique_ptr<BitDelayAudioProcessor>> processors;
+
+        for (int voice = 0; voice < numVoices; ++voice)
+        {
+            auto processor = std::make_unique<BitDelayAudioProcessor>();
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add(juce::AudioChannelSet::mono());
+            layout.outputBuses.add(juce::AudioChannelSet::mono());
+            processor->setBusesLayout(layout);
+            processor->setRateAndBufferSizeDetails(c.sampleRate, c.blockSize);
+            processor->prepareToPlay(c.sampleRate, c.blockSize);
+            processors.push_back(std::move(processor));
+        }
+
+        juce::MidiBuffer midi;
+
+        results.add({ "processBlock (mono per voice)", c, measureNsPerSample([&]
+        {
+            buffer.makeCopyOf(input, true);
+
+            for (int voice = 0; voice < numVoices; ++voice)
+            {
+                juce::AudioBuffer<float> voiceBuffer(buffer.getArrayOfWritePointers() + voice, 1, c.blockSize);
+                processGuarded(*processors[(size_t)voice], voiceBuffer, midi);
+            }
+        }, c.blockSize * numVoices) });
+
+        expectNoAllocation("processBlock (mono per voice)");
+    }
+
+    juce::String getModeName(const BenchCase& c)
+    {
+        if (c.storage == BitDelayAudioProcessor::DelayStorage::compact)
+            return "compact";
+
+        if (c.storage == BitDelayAudioProcessor::DelayStorage::pooled)
+            return "pooled";
+
+        if (c.channelProcessing == BitDelayAudioProcessor::ChannelProcessing::interleaved)
+            return "interleaved";
+
+        return c.fused ? "perChannel" : "perChannelBlockwise";
+    }
+
+    juce::String getInterpolationName(DelayInterpolation::Mode mode)
+    {
+        const char* names[] = { "none", "linear", "cubic", "allpass" };
+        return names[(int)mode];
+    }
+
+    juce::String getDecimationName(DecimationFilter::Mode mode)
+    {
+        const char* names[] = { "hold", "clean", "cleanHigh" };
+        return names[(int)mode];
+    }
+
+    juce::String toCsv(const juce::Array<BenchResult>& results)
+    {
+        juce::String csv = "function,mode,interpolation,decimation,taps,sweep,sampleRate,blockSize,numChannels,threads,time,nsPerSample\n";
+
+        for (auto& r : results)
+            csv << r.function << "," << getModeName(r.benchCase) << "," << getInterpolationName(r.benchCase.interpolation) << ","
+                << getDecimationName(r.benchCase.decimation) << "," << r.benchCase.numTaps << ","
+                << (r.benchCase.sweep ? 1 : 0) << "," << r.benchCase.sampleRate << "," << r.benchCase.blockSize << ","
+                << r.benchCase.numChannels << "," << r.benchCase.numThreads << "," << r.benchCase.time << ","
+                << juce::String(r.nsPerSample, 4) << "\n";
+
+        return csv;
+    }
+
+    juce::String toJson(const juce::Array<BenchResult>& results)
+    {
+        juce::Array<juce::var> entries;
+
+        for (auto& r : results)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("function", r.function);
+            entry->setProperty("mode", getModeName(r.benchCase));
+            entry->setProperty("interpolation", getInterpolationName(r.benchCase.interpolation));
+            entry->setProperty("decimation", getDecimationName(r.benchCase.decimation));
+            entry->setProperty("taps", r.benchCase.numTaps);
+            entry->setProperty("sweep", r.benchCase.sweep);
+            entry->setProperty("sampleRate", r.benchCase.sampleRate);
+            entry->setProperty("blockSize", r.benchCase.blockSize);
+            entry->setProperty("numChannels", r.benchCase.numChannels);
+            entry->setProperty("threads", r.benchCase.numThreads);
+            entry->setProperty("time", r.benchCase.time);
+            entry->setProperty("nsPerSample", r.nsPerSample);
+            entries.add(juce::var(entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("results", entries);
+
+        return juce::JSON::toString(juce::var(root));
+    }
+
+    //==============================================================================
+    //Differential fuzzing: random sessions run through every engine and ReferenceModel
+
+    struct FuzzEngine
+    {
+        const char* name;
+        BitDelayAudioProcessor::DelayStorage storage;
+        BitDelayAudioProcessor::ChannelProcessing channelProcessing;
+        bool fused;
+        bool doublePrecision;   //host blocks go through processBlock(AudioBuffer<double>&)
+    };
+
+    const FuzzEngine fuzzEngines[] = {
+        { "perChannel", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::perChannel, true, false },
+        { "perChannelBlockwise", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::perChannel, false, false },
+        { "interleaved", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::interleaved, true, false },
+        { "pooled", BitDelayAudioProcessor::DelayStorage::pooled, BitDelayAudioProcessor::ChannelProcessing::perChannel, true, false },
+        { "compact", BitDelayAudioProcessor::DelayStorage::compact, BitDelayAudioProcessor::ChannelProcessing::perChannel, true, false },
+        { "perChannelDouble", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::perChannel, true, true },
+        { "perChannelBlockwiseDouble", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::perChannel, false, true },
+        { "interleavedDouble", BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::ChannelProcessing::interleaved, true, true }
+    };
+
+    //A double precision host block holding the same samples as block, processed and copied back
+    void processAsDouble(BitDelayAudioProcessor& processor, juce::AudioBuffer<float>& block, juce::AudioBuffer<double>& scratch)
+    {
+        juce::MidiBuffer midi;
+        scratch.setSize(block.getNumChannels(), block.getNumSamples(), false, false, true);
+
+        for (int channel = 0; channel < block.getNumChannels(); ++channel)
+            for (int i = 0; i < block.getNumSamples(); ++i)
+                scratch.setSample(channel, i, (double)block.getSample(channel, i));
+
+        processGuarded(processor, scratch, midi);
+
+        for (int channel = 0; channel < block.getNumChannels(); ++channel)
+            for (int i = 0; i < block.getNumSamples(); ++i)
+                block.setSample(channel, i, (float)scratch.getSample(channel, i));
+    }
+
+    //One host block: its size and the parameter changes (index, real value) made just before it
+    struct FuzzBlock
+    {
+        int numSamples;
+        juce::Array<std::pair<int, float>> changes;
+    };
+
+    struct FuzzCase
+    {
+        int index;
+        double sampleRate;
+        int maxBlockSize;
+        int numChannels;
+        DecimationFilter::Mode decimation;
+        bool automateMaxTime;
+        int numTaps;    //extra taps with automated parameters
+        juce::Array<std::pair<int, float>> initialValues;
+        juce::Array<FuzzBlock> blocks;
+        juce::AudioBuffer<float> input;
+    };
+
+    //Mostly random values, with the ends of the range and values just inside them
+    //(Time 0, the longest time, the rate divide right at an integer) turning up often
+    float getFuzzValue(const Echo_Parameter& parameter, juce::Random& random)
+    {
+        const auto& range = parameter.range;
+
+        switch (random.nextInt(6))
+        {
+            case 0: return range.start;
+            case 1: return range.end;
+            case 2: return range.snapToLegalValue(range.start + (range.end - range.start) * 0.001f * random.nextFloat());
+            default: break;
+        }
+
+        return getRandomRealValue(parameter, random);
+    }
+
+    //Noise, tones, clicks, full scale, signals around the silence threshold and long
+    //silences (so the delay line decays and the processor goes to sleep)
+    void fillFuzzInput(juce::AudioBuffer<float>& input, juce::Random& random)
+    {
+        const int numSamples = input.getNumSamples();
+        int start = 0;
+
+        while (start < numSamples)
+        {
+            const int length = juce::jmin(numSamples - start, 1 + random.nextInt(random.nextBool() ? 4096 : 96000));
+            const int kind = random.nextInt(7);
+            const float level = random.nextBool() ? random.nextFloat() : 1.0f;
+            const float frequency = 0.001f + 0.4f * random.nextFloat();
+
+            for (int channel = 0; channel < input.getNumChannels(); ++channel)
+            {
+                auto* data = input.getWritePointer(channel, start);
+
+                for (int i = 0; i < length; ++i)
+                {
+                    switch (kind)
+                    {
+                        case 0:  data[i] = level * (random.nextFloat() * 2.0f - 1.0f); break;
+                        case 1:  data[i] = level * std::sin(juce::MathConstants<float>::twoPi * frequency * (float)(i + channel)); break;
+                        case 2:  data[i] = (i % 997) == channel ? level : 0.0f; break;
+                        case 3:  data[i] = (i & 1) ? 1.0f : -1.0f; break;
+                        case 4:  data[i] = DelayEnergyTracker::silenceThreshold * (random.nextFloat() * 2.0f - 0.5f); break;
+                        default: data[i] = 0.0f; break;
+                    }
+                }
+            }
+
+            start += length;
+        }
+    }
+
+    FuzzCase makeFuzzCase(int index, juce::int64 seed, bool quick)
+    {
+        juce::Random random(seed + index);
+        BitDelayAudioProcessor parameters;
+        FuzzCase c;
+
+        const double sampleRates[] = { 11025.0, 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+        const int blockSizes[] = { 1, 7, 32, 64, 100, 256, 511, 1024, 4096, 16384 };
+        const int channelCounts[] = { 1, 2, 3, 6, 9 };
+
+        c.index = index;
+        c.sampleRate = sampleRates[random.nextInt(juce::numElementsInArray(sampleRates))];
+        c.maxBlockSize = blockSizes[random.nextInt(juce::numElementsInArray(blockSizes))];
+        c.numChannels = channelCounts[random.nextInt(juce::numElementsInArray(channelCounts))];
+        c.decimation = random.nextInt(4) == 0 ? (DecimationFilter::Mode)(1 + random.nextInt(DecimationFilter::numModes - 1))
+                                              : DecimationFilter::Mode::hold;
+        c.automateMaxTime = random.nextBool();
+
+        //Everything but Decimation, which stays put for the whole case, and the
+        //parameters of a random number of extra taps (the others stay silent)
+        juce::Array<int> automated { BitDelayAudioProcessor::mainTime, BitDelayAudioProcessor::mainRegen, BitDelayAudioProcessor::mainDry,
+                                     BitDelayAudioProcessor::mainWet, BitDelayAudioProcessor::mainBitDepth,
+                                     BitDelayAudioProcessor::mainInterpolation, BitDelayAudioProcessor::mainMaxTime };
+        c.numTaps = random.nextInt(MultiTap::maxTaps + 1);
+
+        for (int i = 0; i < c.numTaps * BitDelayAudioProcessor::numTapParameters; ++i)
+            automated.add(BitDelayAudioProcessor::firstTapParameter + i);
+
+        //Some cases go quiet for longer than the line with no feedback to keep it going,
+        //so the processor falls asleep and has to wake up where it would have been.
+        //Max Time stays at its default, which keeps the line short enough, and Regen
+        //comes back with the input so the echoes after waking are heard.
+        const bool sleeps = random.nextInt(6) == 0;
+
+        if (sleeps)
+        {
+            automated.removeFirstMatchingValue(BitDelayAudioProcessor::mainRegen);
+            automated.removeFirstMatchingValue(BitDelayAudioProcessor::mainMaxTime);
+            c.automateMaxTime = false;
+        }
+
+        for (auto parameterIndex : automated)
+            c.initialValues.add({ parameterIndex, getFuzzValue(*parameters.getEchoParameter(parameterIndex), random) });
+
+        if (sleeps)
+            c.initialValues.add({ BitDelayAudioProcessor::mainRegen, 0.0f });
+
+        const int delayLength = (int)(2.0 * c.sampleRate) * 2;
+        const int silenceLength = delayLength + (int)c.sampleRate;
+        double seconds = (quick ? 2.0 : 4.0) + 3.0 * random.nextDouble();
+
+        if (sleeps)
+            seconds = juce::jmax(seconds, 4.0 + silenceLength / c.sampleRate);
+
+        const int totalSamples = (int)(seconds * c.sampleRate);
+        bool sentLongBlock = false;
+        bool restoredRegen = ! sleeps;
+
+        for (int position = 0; position < totalSamples;)
+        {
+            FuzzBlock block;
+
+            switch (random.nextInt(8))
+            {
+                case 0:  block.numSamples = 1 + random.nextInt(c.maxBlockSize); break;
+                case 1:  block.numSamples = c.maxBlockSize + 1 + random.nextInt(2 * c.maxBlockSize); break;
+                default: block.numSamples = c.maxBlockSize; break;
+            }
+
+            //Once per case, a block longer than the delay line
+            if (! sentLongBlock && random.nextInt(200) == 0)
+            {
+                block.numSamples = delayLength + random.nextInt(4096);
+                sentLongBlock = true;
+            }
+
+            block.numSamples = juce::jmin(block.numSamples, totalSamples - position);
+
+            if (! restoredRegen && position >= (int)c.sampleRate + silenceLength)
+            {
+                block.changes.add({ BitDelayAudioProcessor::mainRegen,
+                                    getFuzzValue(*parameters.getMainParameter(BitDelayAudioProcessor::mainRegen), random) });
+                restoredRegen = true;
+            }
+
+            while (random.nextInt(10) == 0)
+            {
+                const int parameterIndex = automated[random.nextInt(automated.size())];
+
+                if (parameterIndex != BitDelayAudioProcessor::mainMaxTime || c.automateMaxTime)
+                    block.changes.add({ parameterIndex, getFuzzValue(*parameters.getEchoParameter(parameterIndex), random) });
+            }
+
+            position += block.numSamples;
+            c.blocks.add(block);
+        }
+
+        c.input.setSize(c.numChannels, totalSamples);
+        fillFuzzInput(c.input, random);
+
+        if (sleeps)
+            c.input.clear((int)c.sampleRate, silenceLength);
+
+        return c;
+    }
+
+    //A pooled line grows on a background thread, so when a longer Max Time takes
+    //effect depends on timing. Runs compared with a pooled one leave Max Time alone.
+    bool followsMaxTime(const FuzzEngine& engine)
+    {
+        return engine.storage != BitDelayAudioProcessor::DelayStorage::pooled;
+    }
+
+    //Runs the case through one engine, or through the model set up like that engine
+    juce::AudioBuffer<float> runFuzzCase(const FuzzCase& c, const FuzzEngine& engine, bool runModel, bool followMaxTime)
+    {
+        BitDelayAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+        processor.setBusesLayout(layout);
+
+        processor.setDelayStorage(engine.storage);
+        processor.setChannelProcessing(engine.channelProcessing);
+        processor.setFusedFeedback(engine.fused);
+
+        for (auto& value : c.initialValues)
+            processor.getEchoParameter(value.first)->setRealValueNotifyingHost(value.second);
+
+        processor.getMainParameter(BitDelayAudioProcessor::mainDecimation)->setRealValueNotifyingHost((float)c.decimation);
+        processor.setRateAndBufferSizeDetails(c.sampleRate, c.maxBlockSize);
+        processor.prepareToPlay(c.sampleRate, c.maxBlockSize);
+
+        //The model takes its delay line length from the prepared processor
+        ReferenceModel model;
+
+        if (runModel)
+            model.prepare(processor);
+
+        juce::AudioBuffer<float> output(c.input);
+        juce::AudioBuffer<double> doubleBlock;
+        juce::MidiBuffer midi;
+        int position = 0;
+
+        for (auto& block : c.blocks)
+        {
+            for (auto& change : block.changes)
+                if (change.first != 7 || followMaxTime)
+                    processor.getEchoParameter(change.first)->setRealValueNotifyingHost(change.second);
+
+            auto* channels = output.getArrayOfWritePointers();
+            juce::HeapBlock<float*> offsetChannels((size_t)c.numChannels);
+
+            for (int channel = 0; channel < c.numChannels; ++channel)
+                offsetChannels[channel] = channels[channel] + position;
+
+            juce::AudioBuffer<float> view(offsetChannels.get(), c.numChannels, block.numSamples);
+
+            if (runModel)
+                model.process(processor, view);
+            else if (engine.doublePrecision)
+                processAsDouble(processor, view, doubleBlock);
+            else
+                processGuarded(processor, view, midi);
+
+            position += block.numSamples;
+        }
+
+        return output;
+    }
+
+    //Largest difference between two runs, and where it is
+    struct FuzzDifference
+    {
+        float maxDifference{ 0.0f };
+        int channel{ 0 };
+        int sample{ 0 };
+        bool finite{ true };
+    };
+
+    FuzzDifference compareFuzzRuns(const juce::AudioBuffer<float>& expected, const juce::AudioBuffer<float>& actual)
+    {
+        FuzzDifference result;
+
+        for (int channel = 0; channel < expected.getNumChannels(); ++channel)
+        {
+            for (int i = 0; i < expected.getNumSamples(); ++i)
+            {
+                const float value = actual.getSample(channel, i);
+                const float difference = std::abs(value - expected.getSample(channel, i));
+
+                if (! std::isfinite(value))
+                    result.finite = false;
+
+                if (difference > result.maxDifference || ! std::isfinite(difference))
+                {
+                    result.maxDifference = std::isfinite(difference) ? difference : std::numeric_limits<float>::infinity();
+                    result.channel = channel;
+                    result.sample = i;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    juce::String describeFuzzCase(const FuzzCase& c)
+    {
+        return "case " + juce::String(c.index) + " (" + juce::String(c.sampleRate) + " Hz, block " + juce::String(c.maxBlockSize)
+             + ", " + juce::String(c.numChannels) + " ch, " + getDecimationName(c.decimation) + ")";
+    }
+
+    //The original decimate() rounded with fmodf. It is the reference here.
+    float decimateWithFmod(float value, int bitDepth)
+    {
+        const float totalQLevels = powf(2, (float)bitDepth);
+        return value - fmodf(value, 1 / totalQLevels);
+    }
+
+    bool isSameQuantized(float expected, float actual)
+    {
+        if (std::isnan(expected))
+            return std::isnan(actual);
+
+        std::uint32_t expectedBits, actualBits;
+        std::memcpy(&expectedBits, &expected, sizeof(float));
+        std::memcpy(&actualBits, &actual, sizeof(float));
+        return expectedBits == actualBits;
+    }
+
+    //Decimator::quantize (at every alignment, so the AVX, SSE and scalar parts all
+    //run), quantizeSample and the per-depth kernels against fmodf, bit for bit, on
+    //random values, denormals, +-0, values at and above 2^23 / qLevels and NaNs
+    void runQuantizeCheck(juce::int64 seed)
+    {
+        juce::Random random(seed);
+        std::vector<float> values;
+
+        auto fromBits = [](std::uint32_t bits)
+        {
+            float value;
+            std::memcpy(&value, &bits, sizeof(float));
+            return value;
+        };
+
+        for (int i = 0; i < 1024; ++i)
+        {
+            const float sign = random.nextBool() ? 1.0f : -1.0f;
+            values.push_back(random.nextFloat() * 4.0f - 2.0f);
+            values.push_back(sign * std::ldexp(1.0f + random.nextFloat(), random.nextInt(80) - 40));
+            values.push_back(fromBits((std::uint32_t)random.nextInt() & 0x807fffffu));
+        }
+
+        for (float value : { 0.0f, -0.0f, std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+                             std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN() })
+            values.push_back(value);
+
+        for (int bitDepth = Decimator::minBitDepth; bitDepth <= Decimator::maxBitDepth; ++bitDepth)
+        {
+            //Where quantizing stops and values pass through, and either side of it
+            const float integralLimit = std::ldexp(1.0f, 23 - bitDepth);
+
+            for (float value : { integralLimit, std::nextafter(integralLimit, 0.0f), integralLimit * 3.0f })
+            {
+                values.push_back(value);
+                values.push_back(-value);
+            }
+        }
+
+        //Shuffled, so the special values land in every lane
+        for (int i = (int)values.size() - 1; i > 0; --i)
+            std::swap(values[(size_t)i], values[(size_t)random.nextInt(i + 1)]);
+
+        std::vector<float> data(values.size());
+
+        for (int bitDepth = Decimator::minBitDepth; bitDepth <= Decimator::maxBitDepth; ++bitDepth)
+        {
+            const float qLevels = std::ldexp(1.0f, bitDepth);
+
+            auto check = [&](const char* function, int first)
+            {
+                for (size_t i = (size_t)first; i < values.size(); ++i)
+                {
+                    if (! isSameQuantized(decimateWithFmod(values[i], bitDepth), data[i]))
+                    {
+                        std::uint32_t bits;
+                        std::memcpy(&bits, &values[i], sizeof(float));
+                        juce::ConsoleApplication::fail("BitDelayBench: " + juce::String(function) + " differs from fmodf at "
+                                                       + juce::String(bitDepth) + " bits for 0x" + juce::String::toHexString((int)bits));
+                    }
+                }
+            };
+
+            for (int first = 0; first < 8; ++first)
+            {
+                data = values;
+                Decimator::quantize(data.data() + first, (int)data.size() - first, qLevels, 1.0f / qLevels);
+                check("Decimator::quantize", first);
+            }
+
+            for (size_t i = 0; i < values.size(); ++i)
+                data[i] = Decimator::quantizeSample(values[i], qLevels, 1.0f / qLevels);
+
+            check("Decimator::quantizeSample", 0);
+
+            data = values;
+            Decimator::ChannelState state;
+            Decimator::process(state, data.data(), (int)data.size(), bitDepth, 1);
+            check("Decimator::process", 0);
+        }
+    }
+
+    //Interpolation None against the original plugin's readFromBuffer, which took
+    //mWritePosition - sampleRate * time, wrapped it once and truncated it to an index.
+    //ReferenceModel reads the same way as DelayInterpolation, so this is the only
+    //check that holds None to the original sound.
+    void runNoneReadCheck(juce::int64 seed)
+    {
+        juce::Random random(seed);
+
+        for (double sampleRate : { 22050.0, 44100.0, 48000.0, 96000.0 })
+        {
+            const int length = juce::nextPowerOfTwo((int)std::ceil(sampleRate * 2.0));
+
+            for (int i = 0; i < 4096; ++i)
+            {
+                const int writePosition = random.nextInt(length);
+
+                //Fractional delays, plus whole ones and the smallest the mode allows
+                float time = 0.001f + random.nextFloat() * 1.5f;
+
+                if (i % 16 == 0)
+                    time = (float)((1 + random.nextInt((int)sampleRate - 1)) / sampleRate);
+                else if (i % 16 == 1)
+                    time = (float)(1.0 / sampleRate);
+
+                auto readPosition = writePosition - (sampleRate * time);
+                if (readPosition < 0)
+                    readPosition += length;
+
+                const int expected = (int)readPosition;
+
+                int index;
+                float fraction;
+                DelayInterpolation::getTapPosition(DelayInterpolation::Mode::none, writePosition, sampleRate * time, length - 1,
+                                                   index, fraction);
+
+                if (index != expected || fraction != 0.0f)
+                    juce::ConsoleApplication::fail("BitDelayBench: interpolation None reads frame " + juce::String(index)
+                                                   + " instead of " + juce::String(expected) + " at " + juce::String(sampleRate)
+                                                   + " Hz, write position " + juce::String(writePosition)
+                                                   + ", time " + juce::String(time, 9));
+            }
+        }
+    }
+
+    //Every engine with every decimation mode, all extra taps and a capture running,
+    //through a Max Time change that makes a pooled line grow and then shrink again.
+    //Only counts anything in builds with BITDELAY_ALLOCATION_GUARD.
+    void runAllocationCheck()
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        const auto tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory);
+        const auto wetFile = tempDirectory.getChildFile("BitDelayBench wet.wav");
+        const auto lineFile = tempDirectory.getChildFile("BitDelayBench line.wav");
+        juce::Random random(0xa110c);
+
+        for (auto& engine : fuzzEngines)
+        {
+            for (int mode = 0; mode < DecimationFilter::numModes; ++mode)
+            {
+                BitDelayAudioProcessor processor;
+
+                juce::AudioProcessor::BusesLayout layout;
+                layout.inputBuses.add(juce::AudioChannelSet::stereo());
+                layout.outputBuses.add(juce::AudioChannelSet::stereo());
+                processor.setBusesLayout(layout);
+
+                processor.setDelayStorage(engine.storage);
+                processor.setChannelProcessing(engine.channelProcessing);
+                processor.setFusedFeedback(engine.fused);
+                processor.getMainParameter(BitDelayAudioProcessor::mainDecimation)->setRealValueNotifyingHost((float)mode);
+
+                for (int tap = 0; tap < MultiTap::maxTaps; ++tap)
+                {
+                    processor.getTapParameter(tap, BitDelayAudioProcessor::tapTime)->setRealValueNotifyingHost(0.2f * (float)(tap + 1));
+                    processor.getTapParameter(tap, BitDelayAudioProcessor::tapLevel)->setRealValueNotifyingHost(0.3f);
+                }
+
+                processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                processor.prepareToPlay(sampleRate, blockSize);
+
+                if (processor.getDelayCapture().start(wetFile, lineFile).failed())
+                    juce::ConsoleApplication::fail("BitDelayBench: can't capture to " + tempDirectory.getFullPathName());
+
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                juce::AudioBuffer<double> doubleBuffer(2, blockSize);
+                juce::MidiBuffer midi;
+
+                auto processNext = [&]
+                {
+                    for (int channel = 0; channel < 2; ++channel)
+                    {
+                        for (int i = 0; i < blockSize; ++i)
+                        {
+                            const float value = random.nextFloat() * 2.0f - 1.0f;
+                            buffer.setSample(channel, i, value);
+                            doubleBuffer.setSample(channel, i, (double)value);
+                        }
+                    }
+
+                    if (engine.doublePrecision)
+                        processGuarded(processor, doubleBuffer, midi);
+                    else
+                        processGuarded(processor, buffer, midi);
+                };
+
+                AllocationGuard::resetViolations();
+
+                for (int i = 0; i < 50; ++i)
+                    processNext();
+
+                //A pooled line follows Max Time on the pool's thread, so it gets time to
+                //catch up in both directions
+                const bool pooled = engine.storage == BitDelayAudioProcessor::DelayStorage::pooled;
+                auto* maxTime = processor.getMainParameter(BitDelayAudioProcessor::mainMaxTime);
+                const int initialLength = processor.getDelayBufferLength();
+                maxTime->setRealValueNotifyingHost(maxTime->range.end);
+
+                for (int i = 0; i < 50 || (pooled && i < 2000 && processor.getDelayBufferLength() == initialLength); ++i)
+                {
+                    processNext();
+
+                    if (pooled)
+                        juce::Thread::sleep(1);
+                }
+
+                if (pooled && processor.getDelayBufferLength() == initialLength)
+                    juce::ConsoleApplication::fail("BitDelayBench: the pooled line never grew");
+
+                maxTime->setRealValueNotifyingHost(maxTime->range.start);
+
+                for (int i = 0; i < 50 || (pooled && i < 2000 && processor.getDelayBufferLength() != initialLength); ++i)
+                {
+                    processNext();
+
+                    if (pooled)
+                        juce::Thread::sleep(1);
+                }
+
+                processor.getDelayCapture().stop();
+                expectNoAllocation(juce::String(engine.name) + " with " + getDecimationName((DecimationFilter::Mode)mode)
+                                   + " decimation and a capture running");
+            }
+        }
+
+        wetFile.deleteFile();
+        lineFile.deleteFile();
+    }
+
+    //Every case is run by each engine and compared with the reference model, or for
+    //the clean decimation modes (which the model leaves out) with the fused engine.
+    //Compact storage holds and quantises the line, so it is only checked for
+    //finite output that stays within what the feedback can build up.
+    int runFuzz(const juce::ArgumentList& args)
+    {
+        const bool quick = args.containsOption("--quick");
+        const auto seed = args.containsOption("--seed") ? args.getValueForOption("--seed").getLargeIntValue() : (juce::int64)0xf022;
+        const int numCases = args.containsOption("--cases") ? args.getValueForOption("--cases").getIntValue() : (quick ? 20 : 200);
+        constexpr float tolerance = 1.0e-4f;
+        float worst = 0.0f;
+
+        runQuantizeCheck(seed);
+        runNoneReadCheck(seed);
+        runAllocationCheck();
+
+        for (int index = 0; index < numCases; ++index)
+        {
+            const auto c = makeFuzzCase(index, seed, quick);
+            std::cerr << "." << std::flush;
+
+            const bool useModel = c.decimation == DecimationFilter::Mode::hold;
+
+            for (auto& engine : fuzzEngines)
+            {
+                AllocationGuard::resetViolations();
+                const auto actual = runFuzzCase(c, engine, false, followsMaxTime(engine));
+                expectNoAllocation(describeFuzzCase(c) + ", " + engine.name);
+
+                const bool compact = engine.storage == BitDelayAudioProcessor::DelayStorage::compact;
+
+                if (compact)
+                {
+                    //The line holds at most input / (1 - regen), the output adds the dry part,
+                    //and every extra tap reads the line again at up to 0.7
+                    const auto peak = compareFuzzRuns(juce::AudioBuffer<float>(c.numChannels, c.input.getNumSamples()), actual);
+
+                    if (! peak.finite || peak.maxDifference > 8.0f * (1.0f + 0.7f * (float)c.numTaps))
+                        juce::ConsoleApplication::fail("BitDelayBench: " + describeFuzzCase(c) + ", compact output out of range");
+
+                    continue;
+                }
+
+                const auto expected = useModel ? runFuzzCase(c, engine, true, followsMaxTime(engine))
+                                               : runFuzzCase(c, fuzzEngines[0], false, followsMaxTime(engine));
+
+                const auto difference = compareFuzzRuns(expected, actual);
+                worst = juce::jmax(worst, difference.maxDifference);
+
+                if (! difference.finite || difference.maxDifference > tolerance)
+                    juce::ConsoleApplication::fail("BitDelayBench: " + describeFuzzCase(c) + ", " + engine.name + " differs from "
+                                                   + (useModel ? "the reference model" : fuzzEngines[0].name) + " by "
+                                                   + juce::String(difference.maxDifference) + " at channel " + juce::String(difference.channel)
+                                                   + ", sample " + juce::String(difference.sample) + " (seed " + juce::String(seed) + ")");
+            }
+        }
+
+        std::cerr << std::endl;
+        std::cout << "fuzz: " << numCases << " cases passed, largest difference " << worst << std::endl;
+        return 0;
+    }
+
+    int runBenchmarks(const juce::ArgumentList& args)
+    {
+        const bool quick = args.containsOption("--quick");
+        const auto format = args.containsOption("--format") ? args.getValueForOption("--format") : juce::String("csv");
+
+        if (format != "csv" && format != "json")
+            juce::ConsoleApplication::fail("BitDelayBench: --format has to be csv or json");
+
+        const juce::Array<double> sampleRates = quick ? juce::Array<double>{ 48000.0 }
+                                                      : juce::Array<double>{ 44100.0, 48000.0, 96000.0, 192000.0 };
+        const juce::Array<int> channelCounts = quick ? juce::Array<int>{ 2, 12 } : juce::Array<int>{ 1, 2, 6, 12, 16 };
+        const juce::Array<float> times = { 0.05f, BitDelayAudioProcessor::timeRangeEnd };
+
+        juce::Array<BenchResult> results;
+        runStateCase(results);
+        runBankCheck();
+        runQuantizeCheck(0x2002);
+        runNoneReadCheck(0x2002);
+        runAllocationCheck();
+
+        for (auto sampleRate : sampleRates)
+            for (int blockSize = 32; blockSize <= 65536; blockSize *= (quick ? 16 : 2))
+                for (auto numChannels : channelCounts)
+                    for (auto time : times)
+                        for (auto storage : { BitDelayAudioProcessor::DelayStorage::full, BitDelayAudioProcessor::DelayStorage::compact,
+                                              BitDelayAudioProcessor::DelayStorage::pooled })
+                            for (auto mode : { BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                                               BitDelayAudioProcessor::ChannelProcessing::interleaved })
+                            {
+                                //Compact and pooled storage always run per channel
+                                if (storage != BitDelayAudioProcessor::DelayStorage::full
+                                    && mode == BitDelayAudioProcessor::ChannelProcessing::interleaved)
+                                    continue;
+
+                                std::cerr << "." << std::flush;
+                                runCase({ sampleRate, blockSize, numChannels, time, mode, DelayInterpolation::Mode::linear, false, storage }, results);
+                            }
+
+        //Fused feedback kernel against the blockwise stages it replaces, with a delay
+        //longer than every block and one shorter than most
+        for (auto sampleRate : sampleRates)
+            for (int blockSize = 32; blockSize <= 8192; blockSize *= (quick ? 16 : 2))
+                for (auto numChannels : channelCounts)
+                    for (auto time : { 0.001f, BitDelayAudioProcessor::timeRangeEnd })
+                    {
+                        std::cerr << "." << std::flush;
+                        BenchCase c{ sampleRate, blockSize, numChannels, time, BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                                     DelayInterpolation::Mode::linear, false, BitDelayAudioProcessor::DelayStorage::full };
+                        c.fused = false;
+                        runCase(c, results);
+                    }
+
+        //Cost of each interpolation mode. The time is off the sample grid so every tap is fractional.
+        for (int blockSize = 64; blockSize <= 4096; blockSize *= (quick ? 64 : 8))
+            for (auto numChannels : channelCounts)
+                for (int interpolation = 0; interpolation < DelayInterpolation::numModes; ++interpolation)
+                    for (auto sweep : { false, true })
+                        for (auto mode : { BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                                           BitDelayAudioProcessor::ChannelProcessing::interleaved })
+                        {
+                            std::cerr << "." << std::flush;
+                            runCase({ 48000.0, blockSize, numChannels, 0.30001f, mode,
+                                      (DelayInterpolation::Mode)interpolation, sweep, BitDelayAudioProcessor::DelayStorage::full }, results);
+                        }
+
+        //Cost of each decimation mode, at a small and a large rate divide
+        for (auto sampleRate : sampleRates)
+            for (int blockSize = 64; blockSize <= 4096; blockSize *= (quick ? 64 : 8))
+                for (auto numChannels : channelCounts)
+                    for (auto time : { 0.05f, BitDelayAudioProcessor::timeRangeEnd })
+                        for (int decimation = 0; decimation < DecimationFilter::numModes; ++decimation)
+                            for (auto mode : { BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                                               BitDelayAudioProcessor::ChannelProcessing::interleaved })
+                            {
+                                std::cerr << "." << std::flush;
+                                BenchCase c{ sampleRate, blockSize, numChannels, time, mode, DelayInterpolation::Mode::linear,
+                                             false, BitDelayAudioProcessor::DelayStorage::full };
+                                c.decimation = (DecimationFilter::Mode)decimation;
+                                runCase(c, results);
+                            }
+
+        //What extra taps add on top of the main one
+        for (int blockSize = 64; blockSize <= 4096; blockSize *= (quick ? 64 : 8))
+            for (auto numChannels : channelCounts)
+                for (auto numTaps : { 1, 4, MultiTap::maxTaps })
+                    for (auto mode : { BitDelayAudioProcessor::ChannelProcessing::perChannel,
+                                       BitDelayAudioProcessor::ChannelProcessing::interleaved })
+                    {
+                        std::cerr << "." << std::flush;
+                        BenchCase c{ 48000.0, blockSize, numChannels, BitDelayAudioProcessor::timeRangeEnd, mode,
+                                     DelayInterpolation::Mode::linear, false, BitDelayAudioProcessor::DelayStorage::full };
+                        c.numTaps = numTaps;
+                        runCase(c, results);
+                    }
+
+        //BitDelayBank: voices x worker threads
+        for (auto numVoices : quick ? juce::Array<int>{ 16, 64 } : juce::Array<int>{ 1, 16, 64, 256 })
+            for (auto numThreads : { 1, 2, 4, 8 })
+            {
+                std::cerr << "." << std::flush;
+                runBankCase(numVoices, numThreads, results);
+            }
+
+        std::cerr << std::endl;
+
+        const auto text = format == "json" ? toJson(results) : toCsv(results);
+
+        if (args.containsOption("--output"))
+        {
+            auto file = args.getFileForOption("--output");
+
+            if (! file.replaceWithText(text))
+                juce::ConsoleApplication::fail("BitDelayBench: can't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << text << std::endl;
+        }
+
+        return 0;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    return juce::ConsoleApplication::invokeCatchingFailures([&]
+    {
+        return args.containsOption("--fuzz") ? runFuzz(args) : runBenchmarks(args);
+    });
+}
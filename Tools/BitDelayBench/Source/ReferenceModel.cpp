@@ -0,0 +1,343 @@
+/*
+  ==============================================================================
+
+    ReferenceModel.cpp
+
+  ==============================================================================
+*/
+
+#include "ReferenceModel.h"
+
+namespace
+{
+    //Truncates towards zero onto the 2^bitDepth grid, the way the original decimate() did
+    float quantize(float value, int bitDepth)
+    {
+        const float qLevels = std::pow(2.0f, (float)bitDepth);
+        return value - std::fmod(value, 1.0f / qLevels);
+    }
+
+    //Closest delay each mode reads without touching the frame being written:
+    //linear and allpass read one frame past the tap, cubic two
+    int getClosestDelay(DelayInterpolation::Mode mode)
+    {
+        switch (mode)
+        {
+            case DelayInterpolation::Mode::none:    return 1;
+            case DelayInterpolation::Mode::cubic:   return 3;
+            default:                                return 2;
+        }
+    }
+
+    //Catmull-Rom through y[-1], y[0], y[1] and y[2], at x between y[0] and y[1]
+    float hermite(float ym1, float y0, float y1, float y2, float x)
+    {
+        const float c1 = 0.5f * (y1 - ym1);
+        const float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+        const float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+        return ((c3 * x + c2) * x + c1) * x + y0;
+    }
+}
+
+void ReferenceModel::Ramp::reset(double sampleRate, double rampSeconds, float initialValue)
+{
+    length = juce::jmax(0, (int)std::floor(rampSeconds * sampleRate));
+    current = start = target = initialValue;
+    stepsDone = length;
+}
+
+void ReferenceModel::Ramp::setTargetValue(float newTarget)
+{
+    if (newTarget == target)
+        return;
+
+    //A new target starts a full-length ramp from wherever the value is now
+    target = newTarget;
+    start = current;
+    stepsDone = 0;
+
+    if (length <= 0)
+        snapToTarget();
+}
+
+void ReferenceModel::Ramp::snapToTarget()
+{
+    current = target;
+    stepsDone = length;
+}
+
+void ReferenceModel::Ramp::process(float* dest, int numSamples)
+{
+    //Step k of the ramp is start + k steps, in float, up to and including the last one;
+    //only after that does the value sit exactly on the target. A time that is off by an
+    //ulp moves a long delay's read by a good fraction of a sample at high rates.
+    const float step = length > 0 ? (target - start) / (float)length : 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (stepsDone < length)
+        {
+            ++stepsDone;
+            dest[i] = start + step * (float)stepsDone;
+            current = stepsDone == length ? target : dest[i];
+        }
+        else
+        {
+            dest[i] = current;
+        }
+    }
+}
+
+void ReferenceModel::prepare(const BitDelayAudioProcessor& processor)
+{
+    mSampleRate = processor.getSampleRate();
+    mMaxChunkSize = processor.getMaxChunkSize();
+    mLength = processor.getDelayBufferLength();
+    mWritePosition = 0;
+    mSilentFrames = 0;
+
+    const auto numChannels = (size_t)processor.getTotalNumInputChannels();
+    mLines.assign(numChannels, std::vector<float>((size_t)mLength, 0.0f));
+    mHeldValues.assign(numChannels, 0.0f);
+    mHoldCounters.assign(numChannels, 0);
+    mAllpassStates.assign(numChannels, 0.0f);
+    mInterpolation = processor.getInterpolation();
+
+    mTime.reset(mSampleRate, BitDelayAudioProcessor::timeSmoothingSeconds, processor.getMainParameter(BitDelayAudioProcessor::mainTime)->get());
+    mRegen.reset(mSampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, processor.getMainParameter(BitDelayAudioProcessor::mainRegen)->get());
+    mDry.reset(mSampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, processor.getMainParameter(BitDelayAudioProcessor::mainDry)->get());
+    mWet.reset(mSampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, processor.getMainParameter(BitDelayAudioProcessor::mainWet)->get());
+
+    for (auto* values : { &mTimes, &mRegens, &mDrys, &mWets })
+        values->assign((size_t)mMaxChunkSize, 0.0f);
+
+    mStereo = numChannels == 2;
+    mTaps.assign((size_t)MultiTap::maxTaps, {});
+
+    for (int index = 0; index < MultiTap::maxTaps; ++index)
+    {
+        auto& tap = mTaps[(size_t)index];
+        const float level = processor.getTapParameter(index, BitDelayAudioProcessor::tapLevel)->get();
+        const float pan = processor.getTapParameter(index, BitDelayAudioProcessor::tapPan)->get();
+
+        tap.time.reset(mSampleRate, BitDelayAudioProcessor::timeSmoothingSeconds,
+                       processor.getTapParameter(index, BitDelayAudioProcessor::tapTime)->get());
+        tap.left.reset(mSampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, mStereo ? level * juce::jmin(1.0f, 1.0f - pan) : level);
+        tap.right.reset(mSampleRate, BitDelayAudioProcessor::gainSmoothingSeconds, mStereo ? level * juce::jmin(1.0f, 1.0f + pan) : level);
+
+        for (auto* values : { &tap.times, &tap.lefts, &tap.rights })
+            values->assign((size_t)mMaxChunkSize, 0.0f);
+
+        tap.allpassStates.assign(numChannels, 0.0f);
+    }
+}
+
+//New targets for the chunk. A tap is on while its gains are or are heading away from 0;
+//one that comes on starts its allpass from rest, one that is off jumps to its time.
+void ReferenceModel::setTapTargets(const BitDelayAudioProcessor& processor)
+{
+    for (int index = 0; index < MultiTap::maxTaps; ++index)
+    {
+        auto& tap = mTaps[(size_t)index];
+        const float level = processor.getTapParameter(index, BitDelayAudioProcessor::tapLevel)->get();
+        const float pan = juce::jlimit(-1.0f, 1.0f, processor.getTapParameter(index, BitDelayAudioProcessor::tapPan)->get());
+        const float left = mStereo ? level * juce::jmin(1.0f, 1.0f - pan) : level;
+        const float right = mStereo ? level * juce::jmin(1.0f, 1.0f + pan) : level;
+
+        tap.time.setTargetValue(processor.getTapParameter(index, BitDelayAudioProcessor::tapTime)->get());
+        tap.left.setTargetValue(left);
+        tap.right.setTargetValue(right);
+
+        const bool active = left != 0.0f || right != 0.0f || tap.left.current != 0.0f || tap.right.current != 0.0f;
+
+        if (! active)
+        {
+            for (auto* smoother : { &tap.time, &tap.left, &tap.right })
+                smoother->snapToTarget();
+        }
+        else if (! tap.active)
+        {
+            std::fill(tap.allpassStates.begin(), tap.allpassStates.end(), 0.0f);
+        }
+
+        tap.active = active;
+    }
+}
+
+void ReferenceModel::process(const BitDelayAudioProcessor& processor, juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    for (int startSample = 0; startSample < numSamples; startSample += mMaxChunkSize)
+        processChunk(processor, buffer, startSample, juce::jmin(mMaxChunkSize, numSamples - startSample));
+}
+
+void ReferenceModel::processChunk(const BitDelayAudioProcessor& processor, juce::AudioBuffer<float>& buffer,
+                                  int startSample, int numSamples)
+{
+    const int numChannels = (int)mLines.size();
+    const float time = processor.getMainParameter(BitDelayAudioProcessor::mainTime)->get();
+    const float regen = processor.getMainParameter(BitDelayAudioProcessor::mainRegen)->get();
+    const float dry = processor.getMainParameter(BitDelayAudioProcessor::mainDry)->get();
+    const float wet = processor.getMainParameter(BitDelayAudioProcessor::mainWet)->get();
+    const int bitDepth = juce::jlimit(Decimator::minBitDepth, Decimator::maxBitDepth,
+                                      juce::roundToInt(processor.getMainParameter(BitDelayAudioProcessor::mainBitDepth)->get()));
+    const float maxTime = processor.getMainParameter(BitDelayAudioProcessor::mainMaxTime)->get();
+    const float timeRange = processor.getMainParameter(BitDelayAudioProcessor::mainTime)->range.end;
+
+    //The Time knob covers 0..Max Time, as far as the line holds that much
+    const double availableSeconds = (mLength - mMaxChunkSize - DelayLine::interpolationPadding) / mSampleRate;
+    const double samplesPerSecond = mSampleRate * (juce::jmin((double)maxTime, availableSeconds) / timeRange);
+
+    bool inputSilent = true;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < numSamples; ++i)
+            inputSilent = inputSilent && std::abs(buffer.getSample(channel, startSample + i)) < DelayEnergyTracker::silenceThreshold;
+
+    if (inputSilent && mSilentFrames >= mLength)
+    {
+        mTime.setTargetValue(time);
+        mRegen.setTargetValue(regen);
+        mDry.setTargetValue(dry);
+        mWet.setTargetValue(wet);
+
+        for (auto* smoother : { &mTime, &mRegen, &mDry, &mWet })
+            smoother->snapToTarget();
+
+        setTapTargets(processor);
+
+        for (auto& tap : mTaps)
+            for (auto* smoother : { &tap.time, &tap.left, &tap.right })
+                smoother->snapToTarget();
+
+        //The write position and the hold phase keep going while asleep
+        const int rateDivide = (int)BitDelayAudioProcessor::derivateSampleRate(mSampleRate, mTime.current);
+
+        for (auto& holdCounter : mHoldCounters)
+            holdCounter = rateDivide > 1 ? ((holdCounter < rateDivide ? holdCounter : 0) + numSamples) % rateDivide : 0;
+
+        mWritePosition = (mWritePosition + numSamples) & (mLength - 1);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(channel, startSample + i, buffer.getSample(channel, startSample + i) * mDry.current);
+
+        return;
+    }
+
+    const int rateDivide = (int)BitDelayAudioProcessor::derivateSampleRate(mSampleRate, mTime.current);
+
+    if (processor.getInterpolation() != mInterpolation)
+    {
+        mInterpolation = processor.getInterpolation();
+        std::fill(mAllpassStates.begin(), mAllpassStates.end(), 0.0f);
+
+        for (auto& tap : mTaps)
+            std::fill(tap.allpassStates.begin(), tap.allpassStates.end(), 0.0f);
+    }
+
+    mTime.setTargetValue(time);
+    mRegen.setTargetValue(regen);
+    mDry.setTargetValue(dry);
+    mWet.setTargetValue(wet);
+    mTime.process(mTimes.data(), numSamples);
+    mRegen.process(mRegens.data(), numSamples);
+    mDry.process(mDrys.data(), numSamples);
+    mWet.process(mWets.data(), numSamples);
+    setTapTargets(processor);
+
+    for (auto& tap : mTaps)
+    {
+        if (tap.active)
+        {
+            tap.time.process(tap.times.data(), numSamples);
+            tap.left.process(tap.lefts.data(), numSamples);
+            tap.right.process(tap.rights.data(), numSamples);
+        }
+    }
+
+    float peak = 0.0f;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& line = mLines[(size_t)channel];
+        auto& held = mHeldValues[(size_t)channel];
+        auto& holdCounter = mHoldCounters[(size_t)channel];
+
+        //A hold left over from a lower rate ends when the rate goes up
+        if (rateDivide <= 1 || holdCounter >= rateDivide)
+            holdCounter = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int position = mWritePosition + i;
+            const float input = buffer.getSample(channel, startSample + i);
+            float decimated = quantize(input, bitDepth);
+
+            if (rateDivide > 1)
+            {
+                if (holdCounter == 0)
+                    held = decimated;
+
+                decimated = held;
+                holdCounter = (holdCounter + 1) % rateDivide;
+            }
+
+            const float tap = readTap(channel, mInterpolation, samplesPerSecond * mTimes[(size_t)i], position,
+                                      mAllpassStates[(size_t)channel]);
+            const float written = decimated + tap * mRegens[(size_t)i];
+
+            line[(size_t)(position & (mLength - 1))] = written;
+            peak = juce::jmax(peak, std::abs(written));
+
+            //The extra taps only reach the output
+            float extraTaps = 0.0f;
+
+            for (auto& extra : mTaps)
+            {
+                if (extra.active)
+                {
+                    const float gain = mStereo && channel == 1 ? extra.rights[(size_t)i] : extra.lefts[(size_t)i];
+                    extraTaps += gain * readTap(channel, mInterpolation, samplesPerSecond * extra.times[(size_t)i], position,
+                                                extra.allpassStates[(size_t)channel]);
+                }
+            }
+
+            buffer.setSample(channel, startSample + i,
+                             input * mDrys[(size_t)i] + (written - decimated + extraTaps) * mWets[(size_t)i]);
+        }
+    }
+
+    mSilentFrames = peak < DelayEnergyTracker::silenceThreshold ? juce::jmin(mSilentFrames + numSamples, 1 << 30) : 0;
+    mWritePosition = (mWritePosition + numSamples) & (mLength - 1);
+}
+
+//The frame delaySamples before position (never closer than the mode can read
+//without touching the frame being written), interpolated
+float ReferenceModel::readTap(int channel, DelayInterpolation::Mode mode, double delaySamples, int position, float& allpassState)
+{
+    using Mode = DelayInterpolation::Mode;
+
+    const auto& line = mLines[(size_t)channel];
+    const int mask = mLength - 1;
+    delaySamples = juce::jmax(delaySamples, (double)getClosestDelay(mode));
+
+    auto frame = [&](int index) { return line[(size_t)(index & mask)]; };
+
+    const double exact = (double)position - delaySamples;
+    const int index = (int)std::floor(exact);
+    const float fraction = (float)(exact - std::floor(exact));
+
+    if (mode == Mode::none)
+        return frame(index);
+
+    if (mode == Mode::linear)
+        return frame(index) + (frame(index + 1) - frame(index)) * fraction;
+
+    if (mode == Mode::cubic)
+        return hermite(frame(index - 1), frame(index), frame(index + 1), frame(index + 2), fraction);
+
+    allpassState = fraction / (2.0f - fraction) * (frame(index + 1) - allpassState) + frame(index);
+    return allpassState;
+}
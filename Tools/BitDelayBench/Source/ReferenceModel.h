@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    ReferenceModel.h
+
+    Plain scalar model of what BitDelayAudioProcessor does to the sound,
+    for the differential fuzz run (BitDelayBench --fuzz). One sample and
+    one channel at a time, a float vector per channel for the delay line
+    and no SIMD, spans, guard regions, fused loops or block tricks, so it
+    can be read against the description of the effect rather than against
+    the optimised engines.
+
+    It follows the processor's behaviour where that behaviour is part of
+    the sound: host blocks are cut into chunks of getMaxChunkSize() frames,
+    the rate divide is picked at the start of each chunk from the smoothed
+    time, parameters ramp linearly over the processor's smoothing times,
+    and a chunk is skipped
+    (dry only, parameters snap, write position and hold phase move on)
+    once the line and the input have been below
+    DelayEnergyTracker::silenceThreshold long enough.
+
+    The extra taps (MultiTap) are read right after each sample is written,
+    with their own ramps and allpass states, and added to the wet signal.
+
+    Quantizing, ramps, the Hermite weights and the closest delay each
+    interpolation can read are written out here again rather than taken
+    from Decimator, ParameterSmoother and DelayInterpolation, so a mistake
+    there can't hide in both sides of the comparison.
+
+    Covers float delay storage (full and pooled) with plain sample-and-hold
+    decimation. Compact storage and the clean decimation modes are checked
+    engine against engine instead.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#include <vector>
+
+class ReferenceModel
+{
+public:
+    //Takes the sample rate, block size, channel count and delay line length
+    //from a processor that has just been prepared
+    void prepare(const BitDelayAudioProcessor& processor);
+
+    //Processes buffer in place with the processor's current parameter values
+    void process(const BitDelayAudioProcessor& processor, juce::AudioBuffer<float>& buffer);
+
+private:
+    //A value that moves in a straight line to its target over a fixed number of samples
+    struct Ramp
+    {
+        void reset(double sampleRate, double rampSeconds, float initialValue);
+        void setTargetValue(float newTarget);
+        void snapToTarget();
+        void process(float* dest, int numSamples);
+
+        float current{ 0.0f }, start{ 0.0f }, target{ 0.0f };
+        int length{ 0 }, stepsDone{ 0 };
+    };
+
+    void processChunk(const BitDelayAudioProcessor& processor, juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    float readTap(int channel, DelayInterpolation::Mode mode, double delaySamples, int position, float& allpassState);
+    void setTapTargets(const BitDelayAudioProcessor& processor);
+
+    struct Tap
+    {
+        Ramp time, left, right;
+        std::vector<float> times, lefts, rights;
+        std::vector<float> allpassStates;   //per channel
+        bool active{ false };
+    };
+
+    double mSampleRate{ 0.0 };
+    int mMaxChunkSize{ 0 };
+    int mLength{ 0 };
+    int mWritePosition{ 0 };
+    int mSilentFrames{ 0 };
+
+    std::vector<std::vector<float>> mLines;
+    std::vector<float> mHeldValues;
+    std::vector<int> mHoldCounters;
+    std::vector<float> mAllpassStates;
+    DelayInterpolation::Mode mInterpolation{ DelayInterpolation::Mode::linear };
+
+    Ramp mTime, mRegen, mDry, mWet;
+    std::vector<float> mTimes, mRegens, mDrys, mWets;
+    std::vector<Tap> mTaps;
+    bool mStereo{ false };
+};
@@ -0,0 +1,527 @@
+/*
+  ==============================================================================
+
+    BitDelayRender
+
+    Headless offline renderer. Streams an audio file through
+    BitDelayAudioProcessor::processBlock in large blocks, faster than real
+    time, and writes the result.
+
+    BitDelayRender --input in.wav --output out.wav [options]
+        --block <samples>       processing block size (default 8192)
+        --bits <16|24|32>       output bit depth (default 24)
+        --tail <seconds>        extra silence rendered after the input
+                                (default: the processor's tail length)
+        --preset <file>         text file with one "Name = value" per line
+        --set <Name=value>      set one parameter, can be repeated and
+                                overrides values from the preset
+        --compact               store the delay line in the compact format
+                                (see CompactDelayLine)
+        --pooled                store the delay line in pooled chunks that
+                                follow "Max Time" (see PooledDelayLine)
+        --stats <file>          write processBlock's DspStats to file, as
+                                JSON if it ends in .json, else as CSV
+        --threads <n>           render segments of the file on n threads
+                                (default 1, a plain serial render)
+        --segment <seconds>     segment length for --threads (default: 60 s,
+                                or 4 times the pre-roll if that is longer)
+        --verify                with --threads, also render serially and fail
+                                if a segment is further off than promised below
+
+    Parameters are matched by name, case-insensitive ("Time", "Regen",
+    "Dry Volume", ...). The real-time factor is printed when done.
+
+    With --threads every segment gets its own processor, which first runs
+    the input before the segment for the processor's pre-roll
+    (getPreRollSeconds: the longest delay plus the repeats it takes the
+    feedback to die away) and throws that output away. The pre-roll starts
+    on a multiple of the block size, the rate divide and the compact line's
+    storage divide, so block grid, hold phase and stored samples line up
+    with a serial render. Only what the discarded input would still have
+    added is missing, and that is below -80 dBFS, so segments match a
+    serial render to within 1e-4. With --compact a stored sample can also
+    round the other way, one storage step (2^-13), so the bound there is
+    1e-4 + 2^-13. Segments are written in order as they finish; at most 2
+    per thread are held in memory. --verify runs the serial render on the
+    main thread alongside and checks each segment against it.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+    void fail(const juce::String& message)
+    {
+        juce::ConsoleApplication::fail("BitDelayRender: " + message);
+    }
+
+    juce::AudioProcessorParameter* findParameter(juce::AudioProcessor& processor, const juce::String& name)
+    {
+        for (auto* parameter : processor.getParameters())
+            if (parameter->getName(100).equalsIgnoreCase(name.trim()))
+                return parameter;
+
+        return nullptr;
+    }
+
+    void applyParameter(juce::AudioProcessor& processor, const juce::String& assignment)
+    {
+        auto name = assignment.upToFirstOccurrenceOf("=", false, false).trim();
+        auto value = assignment.fromFirstOccurrenceOf("=", false, false).trim();
+
+        auto* parameter = findParameter(processor, name);
+
+        if (parameter == nullptr || value.isEmpty())
+            fail("can't apply \"" + assignment + "\"");
+
+        //Values are given in real units, the parameter maps them to 0..1
+        parameter->setValue(parameter->getValueForText(value));
+    }
+
+    void applyPreset(juce::AudioProcessor& processor, const juce::File& presetFile)
+    {
+        juce::StringArray lines;
+        presetFile.readLines(lines);
+
+        for (auto& line : lines)
+        {
+            auto trimmed = line.upToFirstOccurrenceOf("#", false, false).trim();
+
+            if (trimmed.isNotEmpty())
+                applyParameter(processor, trimmed);
+        }
+    }
+
+    //One row: the totals, then the block count of each size bin
+    juce::String statsToCsv(const DspStats::Snapshot& stats)
+    {
+        juce::String header = "sampleRate,blocks,samples,averageLoad,peakLoad,overruns,nsPerSample,cyclesPerSample,worstNs,worstBlockSize";
+        juce::String row;
+        row << stats.sampleRate << "," << (juce::int64)stats.numBlocks << "," << (juce::int64)stats.numSamples << ","
+            << juce::String(stats.getAverageLoad(), 6) << "," << juce::String(stats.peakLoad, 6) << ","
+            << (juce::int64)stats.numOverruns << "," << juce::String(stats.getNanosecondsPerSample(), 4) << ","
+            << juce::String(stats.getCyclesPerSample(), 4) << "," << (juce::int64)stats.worstNanoseconds << ","
+            << stats.worstBlockSize;
+
+        for (int bin = 0; bin < DspStats::numSizeBins; ++bin)
+        {
+            header << ",blocks" << DspStats::Snapshot::getBinStart(bin) << (bin == DspStats::numSizeBins - 1 ? "+" : "");
+            row << "," << (juce::int64)stats.blockSizes[(size_t)bin];
+        }
+
+        return header + "\n" + row + "\n";
+    }
+
+    juce::String statsToJson(const DspStats::Snapshot& stats)
+    {
+        juce::Array<juce::var> blockSizes;
+
+        for (int bin = 0; bin < DspStats::numSizeBins; ++bin)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("minSize", DspStats::Snapshot::getBinStart(bin));
+            entry->setProperty("blocks", (juce::int64)stats.blockSizes[(size_t)bin]);
+            blockSizes.add(juce::var(entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("sampleRate", stats.sampleRate);
+        root->setProperty("blocks", (juce::int64)stats.numBlocks);
+        root->setProperty("samples", (juce::int64)stats.numSamples);
+        root->setProperty("averageLoad", stats.getAverageLoad());
+        root->setProperty("peakLoad", stats.peakLoad);
+        root->setProperty("overruns", (juce::int64)stats.numOverruns);
+        root->setProperty("nsPerSample", stats.getNanosecondsPerSample());
+        root->setProperty("cyclesPerSample", stats.getCyclesPerSample());
+        root->setProperty("worstNs", (juce::int64)stats.worstNanoseconds);
+        root->setProperty("worstBlockSize", stats.worstBlockSize);
+        root->setProperty("blockSizes", blockSizes);
+
+        return juce::JSON::toString(juce::var(root));
+    }
+
+    //Every processor of a render is set up alike: the file's channel layout, the
+    //parameters (handed on as plugin state) and the delay storage
+    struct RenderSettings
+    {
+        double sampleRate{ 0.0 };
+        int numChannels{ 0 };
+        int blockSize{ 0 };
+        BitDelayAudioProcessor::DelayStorage storage{ BitDelayAudioProcessor::DelayStorage::full };
+        juce::MemoryBlock state;
+    };
+
+    //The processor runs with the same layout on input and output as the file has channels
+    bool setLayout(BitDelayAudioProcessor& processor, int numChannels)
+    {
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+
+        return processor.setBusesLayout(layout);
+    }
+
+    void prepare(BitDelayAudioProcessor& processor, const RenderSettings& settings)
+    {
+        processor.setDelayStorage(settings.storage);
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(settings.sampleRate, settings.blockSize);
+        processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+    }
+
+    //numSamples of input from position, silent past the end of the file
+    void readBlock(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& buffer, juce::int64 position, int numSamples,
+                   juce::int64 inputLength)
+    {
+        const int numToRead = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, inputLength - position);
+
+        buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+        buffer.clear();
+
+        if (numToRead > 0)
+            reader.read(&buffer, 0, numToRead, position, true, true);
+    }
+
+    //start..end of the output, rendered by a processor that first runs the input from
+    //preRollStart and throws that part away
+    struct Segment
+    {
+        juce::int64 preRollStart{ 0 };
+        juce::int64 start{ 0 };
+        juce::int64 end{ 0 };
+        juce::AudioBuffer<float> output;
+        juce::int64 processingTicks{ 0 };
+        juce::String error;
+        juce::WaitableEvent done;
+    };
+
+    //Runs on a pool thread, so errors are left in the segment for the main thread
+    void renderSegment(Segment& segment, const RenderSettings& settings, const juce::File& inputFile, juce::int64 inputLength)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+
+        if (reader == nullptr)
+        {
+            segment.error = "can't read " + inputFile.getFullPathName();
+            return;
+        }
+
+        BitDelayAudioProcessor processor;
+        setLayout(processor, settings.numChannels);
+        processor.setStateInformation(settings.state.getData(), (int)settings.state.getSize());
+        prepare(processor, settings);
+
+        segment.output.setSize(settings.numChannels, (int)(segment.end - segment.start));
+        juce::AudioBuffer<float> buffer(settings.numChannels, settings.blockSize);
+        juce::MidiBuffer midi;
+
+        //The pre-roll and the segment both start on the block grid, so a block is either
+        //all pre-roll or all output
+        for (auto position = segment.preRollStart; position < segment.end; position += settings.blockSize)
+        {
+            const int numSamples = (int)juce::jmin((juce::int64)settings.blockSize, segment.end - position);
+            readBlock(*reader, buffer, position, numSamples, inputLength);
+
+            const auto blockStart = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            segment.processingTicks += juce::Time::getHighResolutionTicks() - blockStart;
+
+            if (position >= segment.start)
+                for (int channel = 0; channel < settings.numChannels; ++channel)
+                    segment.output.copyFrom(channel, (int)(position - segment.start), buffer, channel, 0, numSamples);
+        }
+
+        processor.releaseResources();
+    }
+
+    //Largest difference between a segmented and a serial render, see the header
+    float getSegmentTolerance(const RenderSettings& settings)
+    {
+        const float storageStep = 1.0f / 8192.0f;  //CompactDelayLine resolution, 2^-13
+
+        return settings.storage == BitDelayAudioProcessor::DelayStorage::compact ? 1.0e-4f + storageStep : 1.0e-4f;
+    }
+
+    //--verify: a serial render, advanced one segment at a time and compared with it
+    struct SerialCheck
+    {
+        BitDelayAudioProcessor& processor;
+        juce::AudioFormatReader& reader;
+        juce::int64 inputLength;
+        float maxDifference{ 0.0f };
+        juce::int64 worstSample{ 0 };
+
+        //Segments start on the block grid, so these blocks are the ones a serial render has
+        void compare(const Segment& segment, const RenderSettings& settings)
+        {
+            juce::AudioBuffer<float> buffer(settings.numChannels, settings.blockSize);
+            juce::MidiBuffer midi;
+
+            for (auto position = segment.start; position < segment.end; position += settings.blockSize)
+            {
+                const int numSamples = (int)juce::jmin((juce::int64)settings.blockSize, segment.end - position);
+                readBlock(reader, buffer, position, numSamples, inputLength);
+                processor.processBlock(buffer, midi);
+
+                for (int channel = 0; channel < settings.numChannels; ++channel)
+                {
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        const float difference = std::abs(buffer.getSample(channel, i)
+                                                          - segment.output.getSample(channel, (int)(position - segment.start) + i));
+
+                        if (difference > maxDifference || std::isnan(difference))
+                        {
+                            maxDifference = std::isnan(difference) ? std::numeric_limits<float>::infinity() : difference;
+                            worstSample = position + i;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    //Renders totalLength samples in segments on numThreads threads and writes them in
+    //order as they finish. Returns the processing time summed over all threads.
+    juce::int64 renderSegments(BitDelayAudioProcessor& processor, const RenderSettings& settings, const juce::File& inputFile,
+                               juce::int64 inputLength, juce::int64 totalLength, int numThreads, double segmentSeconds,
+                               juce::AudioFormatWriter& writer, SerialCheck* check)
+    {
+        const auto preRoll = (juce::int64)std::ceil(processor.getPreRollSeconds() * settings.sampleRate);
+
+        if (segmentSeconds <= 0.0)
+            segmentSeconds = juce::jmax(60.0, 4.0 * (double)preRoll / settings.sampleRate);
+
+        //Where a serial render has the same block grid, hold phase and compact storage grid
+        auto grid = std::lcm((juce::int64)settings.blockSize, (juce::int64)juce::jmax(1, (int)processor.derivateSampleRate(settings.sampleRate)));
+
+        if (settings.storage == BitDelayAudioProcessor::DelayStorage::compact)
+            grid = std::lcm(grid, (juce::int64)CompactDelayLine::getStorageDivide(settings.sampleRate));
+
+        const auto segmentLength = juce::jmax((juce::int64)1, (juce::int64)(segmentSeconds * settings.sampleRate) / settings.blockSize)
+                                   * settings.blockSize;
+
+        std::vector<std::unique_ptr<Segment>> segments;
+
+        for (juce::int64 start = 0; start < totalLength; start += segmentLength)
+        {
+            auto segment = std::make_unique<Segment>();
+            segment->preRollStart = juce::jmax((juce::int64)0, start - preRoll) / grid * grid;
+            segment->start = start;
+            segment->end = juce::jmin(start + segmentLength, totalLength);
+            segments.push_back(std::move(segment));
+        }
+
+        std::cout << segments.size() << " segments of " << (double)segmentLength / settings.sampleRate << " s on "
+                  << numThreads << " threads, pre-roll " << (double)preRoll / settings.sampleRate << " s" << std::endl;
+
+        //Declared after the segments, so it is gone (and its jobs finished) before they are
+        juce::ThreadPool pool(numThreads);
+        const size_t maxSegmentsInMemory = (size_t)numThreads * 2;
+        size_t numStarted = 0;
+        juce::int64 processingTicks = 0;
+
+        for (size_t index = 0; index < segments.size(); ++index)
+        {
+            while (numStarted < segments.size() && numStarted < index + maxSegmentsInMemory)
+            {
+                auto* segment = segments[numStarted++].get();
+
+                pool.addJob([segment, &settings, &inputFile, inputLength]
+                {
+                    renderSegment(*segment, settings, inputFile, inputLength);
+                    segment->done.signal();
+                });
+            }
+
+            auto& segment = *segments[index];
+            segment.done.wait();
+
+            if (segment.error.isNotEmpty())
+                fail(segment.error);
+
+            if (! writer.writeFromAudioSampleBuffer(segment.output, 0, segment.output.getNumSamples()))
+                fail("write failed at sample " + juce::String(segment.start));
+
+            if (check != nullptr)
+                check->compare(segment, settings);
+
+            processingTicks += segment.processingTicks;
+            segment.output.setSize(0, 0);
+        }
+
+        return processingTicks;
+    }
+
+    int render(const juce::ArgumentList& args)
+    {
+        if (! args.containsOption("--input") || ! args.containsOption("--output"))
+            fail("usage: BitDelayRender --input in.wav --output out.wav [--block n] [--bits n] [--tail s] [--preset file] [--set Name=value] [--compact|--pooled] [--stats file] [--threads n] [--segment s] [--verify]");
+
+        auto inputFile = args.getExistingFileForOption("--input");
+        auto outputFile = args.getFileForOption("--output");
+        const int blockSize = args.containsOption("--block") ? args.getValueForOption("--block").getIntValue() : 8192;
+        const int bitsPerSample = args.containsOption("--bits") ? args.getValueForOption("--bits").getIntValue() : 24;
+
+        const int numThreads = args.containsOption("--threads") ? args.getValueForOption("--threads").getIntValue() : 1;
+        const double segmentSeconds = args.containsOption("--segment") ? args.getValueForOption("--segment").getDoubleValue() : 0.0;
+
+        if (blockSize <= 0)
+            fail("block size has to be positive");
+
+        if (numThreads <= 0)
+            fail("--threads has to be positive");
+
+        //Every segment has its own processor and statistics
+        if (numThreads > 1 && args.containsOption("--stats"))
+            fail("--stats needs a serial render (--threads 1)");
+
+        const bool verify = args.containsOption("--verify");
+
+        if (verify && numThreads <= 1)
+            fail("--verify compares a segmented render with a serial one, it needs --threads");
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+
+        if (reader == nullptr)
+            fail("can't read " + inputFile.getFullPathName());
+
+        const auto sampleRate = reader->sampleRate;
+        const int numChannels = (int)reader->numChannels;
+
+        BitDelayAudioProcessor processor;
+
+        if (! setLayout(processor, numChannels))
+            fail("BitDelay doesn't support " + juce::String(numChannels) + " channels");
+
+        if (args.containsOption("--preset"))
+            applyPreset(processor, args.getExistingFileForOption("--preset"));
+
+        for (int i = 0; i < args.size(); ++i)
+            if (args[i] == "--set" && i + 1 < args.size())
+                applyParameter(processor, args[++i].text);
+
+        RenderSettings settings;
+        settings.sampleRate = sampleRate;
+        settings.numChannels = numChannels;
+        settings.blockSize = blockSize;
+
+        if (args.containsOption("--compact"))
+            settings.storage = BitDelayAudioProcessor::DelayStorage::compact;
+        else if (args.containsOption("--pooled"))
+            settings.storage = BitDelayAudioProcessor::DelayStorage::pooled;
+
+        processor.getStateInformation(settings.state);
+        prepare(processor, settings);
+
+        auto* format = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+
+        if (format == nullptr)
+            fail("unknown output format " + outputFile.getFileExtension());
+
+        outputFile.deleteFile();
+        auto outputStream = outputFile.createOutputStream();
+
+        if (outputStream == nullptr)
+            fail("can't write " + outputFile.getFullPathName());
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(outputStream.get(), sampleRate,
+                                                                                (unsigned int)numChannels, bitsPerSample, {}, 0));
+
+        if (writer == nullptr)
+            fail("can't create a " + format->getFormatName() + " writer with these settings");
+
+        outputStream.release(); //the writer owns the stream now
+
+        const double tailSeconds = args.containsOption("--tail") ? args.getValueForOption("--tail").getDoubleValue()
+                                                                 : processor.getTailLengthSeconds();
+        const auto inputLength = reader->lengthInSamples;
+        const auto totalLength = inputLength + (juce::int64)(juce::jmax(0.0, tailSeconds) * sampleRate);
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 processingTicks = 0;
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        if (numThreads > 1)
+        {
+            //The main processor and reader are free during a segmented render, so they run the serial one
+            SerialCheck check{ processor, *reader, inputLength };
+            processingTicks = renderSegments(processor, settings, inputFile, inputLength, totalLength, numThreads, segmentSeconds,
+                                             *writer, verify ? &check : nullptr);
+
+            if (verify)
+            {
+                const float tolerance = getSegmentTolerance(settings);
+
+                if (! (check.maxDifference <= tolerance))
+                    fail("the segments differ from a serial render by " + juce::String(check.maxDifference) + " at sample "
+                         + juce::String(check.worstSample) + ", more than " + juce::String(tolerance));
+
+                std::cout << "Matches a serial render to within " << check.maxDifference << " (tolerance " << tolerance << ")" << std::endl;
+            }
+        }
+        else
+        {
+            for (juce::int64 position = 0; position < totalLength; position += blockSize)
+            {
+                const int numSamples = (int)juce::jmin((juce::int64)blockSize, totalLength - position);
+                readBlock(*reader, buffer, position, numSamples, inputLength);
+
+                const auto blockStart = juce::Time::getHighResolutionTicks();
+                processor.processBlock(buffer, midi);
+                processingTicks += juce::Time::getHighResolutionTicks() - blockStart;
+
+                if (! writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+                    fail("write failed at sample " + juce::String(position));
+            }
+        }
+
+        writer.reset();
+
+        if (args.containsOption("--stats"))
+        {
+            if (! DspStats::enabled)
+                fail("--stats needs a build with BITDELAY_DSP_STATS=1");
+
+            auto statsFile = args.getFileForOption("--stats");
+            const auto stats = processor.getDspStats().getSnapshot();
+            const auto text = statsFile.hasFileExtension("json") ? statsToJson(stats) : statsToCsv(stats);
+
+            if (! statsFile.replaceWithText(text))
+                fail("can't write " + statsFile.getFullPathName());
+        }
+
+        processor.releaseResources();
+
+        const auto audioSeconds = (double)totalLength / sampleRate;
+        const auto processSeconds = juce::Time::highResolutionTicksToSeconds(processingTicks);
+        const auto wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+
+        std::cout << "Rendered " << audioSeconds << " s of audio (" << numChannels << " ch, "
+                  << sampleRate << " Hz, block " << blockSize << ")" << std::endl
+                  << "processBlock: " << processSeconds << " s, " << audioSeconds / juce::jmax(1.0e-9, processSeconds) << "x real time" << std::endl
+                  << "total incl. file I/O: " << wallSeconds << " s, " << audioSeconds / juce::jmax(1.0e-9, wallSeconds) << "x real time" << std::endl;
+
+        return 0;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    return juce::ConsoleApplication::invokeCatchingFailures([&] { return render(args); });
+}